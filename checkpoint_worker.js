@@ -0,0 +1,50 @@
+// Writes rollout checkpoints through to IndexedDB for the page.  The
+// page is busy for the whole of a rollout, so FS.syncfs() only gets to
+// run once the rollout is over; this worker has an event loop of its
+// own and stores each checkpoint as it comes (see CheckpointWrite() in
+// gnubg_web.html).
+//
+// The records are the ones IDBFS keeps for the files under /cache: the
+// database is named after the mount point, the store is FILE_DATA and
+// each file is kept under its path with its timestamp, mode and
+// contents.  The page opened the database when it mounted /cache, and
+// loads the checkpoint back from it on the next visit.
+
+var db = null;
+var waiting = [];
+
+function store(data) {
+    var transaction = db.transaction(["FILE_DATA"], "readwrite");
+
+    transaction.onerror = function() {
+        console.log(transaction.error);
+    };
+    transaction.objectStore("FILE_DATA").put({
+        timestamp: data.timestamp,
+        mode: data.mode,
+        contents: data.contents
+    }, data.path);
+}
+
+function open(name) {
+    var request = indexedDB.open(name);
+
+    request.onsuccess = function() {
+        db = request.result;
+        waiting.forEach(store);
+        waiting = [];
+    };
+    request.onerror = function() {
+        console.log(request.error);
+    };
+}
+
+onmessage = function(event) {
+    if (db)
+        store(event.data);
+    else {
+        if (!waiting.length)
+            open(event.data.mount);
+        waiting.push(event.data);
+    }
+};
@@ -86,6 +86,10 @@ typedef struct _player {
     int h;
     /* For PLAYER_EXTERNAL: */
     char *szSocket;
+    /* For PLAYER_GNU: milliseconds allowed to deepen esChequer and esCube
+     * evaluations one ply at a time, or 0 for no limit */
+    unsigned int nChequerTime;
+    unsigned int nCubeTime;
 } player;
 
 typedef enum _movetype {
@@ -313,6 +317,7 @@ extern char *default_export_folder;
 extern char *default_import_folder;
 extern char *default_sgf_folder;
 extern char *log_file_name;
+extern char *szRolloutCheckpoint;
 extern char *szCurrentFileName;
 extern char *szCurrentFolder;
 extern const char szDefaultPrompt[];
@@ -347,6 +352,7 @@ extern int fConfirmSave;
 extern int nAutoSaveTime;
 extern int fAutoSaveRollout;
 extern int fAutoSaveAnalysis;
+extern int fAutoSaveCheckpoint;
 extern int fAutoSaveConfirmDelete;
 extern int fCubeEqualChequer;
 extern int fPlayersAreSame;
@@ -392,6 +398,9 @@ extern unsigned int afCheatRoll[2];
 extern unsigned int cAutoDoubles;
 extern unsigned int nBeavers;
 extern unsigned int nDefaultLength;
+#if USE_MULTITHREAD
+extern unsigned int nRolloutMergeInterval;
+#endif
 extern rngcontext *rngctxRollout;
 
 extern command acAnnotateMove[];
@@ -402,6 +411,7 @@ extern command acSetEvaluation[];
 extern command acSetExportParameters[];
 extern command acSetGeometryValues[];
 extern command acSetPlayer[];
+extern command acSetPlayerEvalParam[];
 extern command acSetRNG[];
 extern command acSetRollout[];
 extern command acSetRolloutJsd[];
@@ -542,6 +552,7 @@ extern void CommandAnnotateVeryUnlucky(char *);
 extern void CommandCalibrate(char *);
 extern void CommandClearCache(char *);
 extern void CommandClearHint(char *);
+extern void CommandClearStatistics(char *);
 extern void CommandClearTurn(char *);
 extern void CommandCMarkCubeSetNone(char *);
 extern void CommandCMarkCubeSetRollout(char *);
@@ -605,6 +616,7 @@ extern void CommandImportSnowieTxt(char *);
 extern void CommandImportTMG(char *);
 extern void CommandListGame(char *);
 extern void CommandListMatch(char *);
+extern void CommandLoadCache(char *);
 extern void CommandLoadCommands(char *);
 extern void CommandLoadGame(char *);
 extern void CommandLoadMatch(char *);
@@ -633,6 +645,8 @@ extern void CommandRelationalTest(char *);
 extern void CommandResign(char *);
 extern void CommandRoll(char *);
 extern void CommandRollout(char *);
+extern void CommandRolloutResume(char *);
+extern void CommandSaveCache(char *);
 extern void CommandSaveGame(char *);
 extern void CommandSaveMatch(char *);
 extern void CommandSavePosition(char *);
@@ -664,6 +678,8 @@ extern void CommandSetAutoGame(char *);
 extern void CommandSetAutoMove(char *);
 extern void CommandSetAutoRoll(char *);
 extern void CommandSetAutoSaveAnalysis(char *sz);
+extern void CommandSetAutoSaveCheckpoint(char *sz);
+extern void CommandSetAutoSaveCheckpointFile(char *sz);
 extern void CommandSetAutoSaveConfirmDelete(char *sz);
 extern void CommandSetAutoSaveRollout(char *sz);
 extern void CommandSetAutoSaveTime(char *sz);
@@ -696,6 +712,7 @@ extern void CommandSetDelay(char *);
 extern void CommandSetDice(char *);
 extern void CommandSetDisplay(char *);
 extern void CommandSetDockPanels(char *);
+extern void CommandSetEvalBitboardMoves(char *);
 extern void CommandSetEvalChequerplay(char *);
 extern void CommandSetEvalCubedecision(char *);
 extern void CommandSetEvalCubeful(char *);
@@ -706,7 +723,9 @@ extern void CommandSetEvalParamEvaluation(char *);
 extern void CommandSetEvalParamRollout(char *);
 extern void CommandSetEvalParamType(char *);
 extern void CommandSetEvalPlies(char *);
+extern void CommandSetEvalProgressive(char *);
 extern void CommandSetEvalPrune(char *);
+extern void CommandSetEvalQuantized(char *);
 extern void CommandSetEvalSameAsAnalysis(char *);
 extern void CommandSetExportCubeDisplayActual(char *);
 extern void CommandSetExportCubeDisplayBad(char *);
@@ -804,6 +823,7 @@ extern void CommandSetPanelWidth(char *);
 extern void CommandSetPlayer(char *);
 extern void CommandSetPlayerChequerplay(char *);
 extern void CommandSetPlayerCubedecision(char *);
+extern void CommandSetPlayerEvalParamTimed(char *);
 extern void CommandSetPlayerExternal(char *);
 extern void CommandSetPlayerGNU(char *);
 extern void CommandSetPlayerHuman(char *);
@@ -855,6 +875,7 @@ extern void CommandSetRolloutLimitMinGames(char *);
 extern void CommandSetRolloutLogEnable(char *);
 extern void CommandSetRolloutLogFile(char *);
 extern void CommandSetRolloutMaxError(char *);
+extern void CommandSetRolloutMergeInterval(char *);
 extern void CommandSetRolloutMoveFilter(char *);
 extern void CommandSetRolloutPlayer(char *);
 extern void CommandSetRolloutPlayerChequerplay(char *);
@@ -967,11 +988,13 @@ extern void CommandShowPrompt(char *);
 extern void CommandShowRatingOffset(char *);
 extern void CommandShowRNG(char *);
 extern void CommandShowRollout(char *);
+extern void CommandShowRolloutMergeInterval(char *);
 extern void CommandShowRolls(char *);
 extern void CommandShowScore(char *);
 extern void CommandShowScoreSheet(char *);
 extern void CommandShowSeed(char *);
 extern void CommandShowSound(char *);
+extern void CommandShowStatisticsEngine(char *);
 extern void CommandShowStatisticsGame(char *);
 extern void CommandShowStatisticsMatch(char *);
 extern void CommandShowStatisticsSession(char *);
@@ -1020,7 +1043,7 @@ extern void CallbackProgress(void);
 extern void SetRNG(rng * prng, rngcontext * rngctx, rng rngNew, char *szSeed);
 extern int check_resigns(cubeinfo * pci);
 extern int quick_roll(void);
-extern int board_in_list(const movelist * pml, const TanBoard old_board, const TanBoard board, int *an);
+extern int board_in_list(const movecandlist * pml, const TanBoard old_board, const TanBoard board, int *an);
 extern int GetManualDice(unsigned int anDice[2]);
 
 #endif	/* BACKGAMMON_H */
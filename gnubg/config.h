@@ -7,6 +7,14 @@
 #define AC_PKGDATADIR "."
 #define AC_DOCDIR "."
 
+/* emcc -msimd128 gives us 128-bit wasm vectors; use them for the
+ * neural net instead of the SSE/AVX code in lib/neuralnetsse.c */
+#if defined(__wasm_simd128__)
+#define USE_SIMD_INSTRUCTIONS 1
+#define USE_WASM_SIMD 1
+#define DISABLE_SIMD_TEST 1
+#endif
+
 // below are from glib's config.h
 
 #define ALIGNOF_GUINT32 4
@@ -38,6 +38,9 @@
 #include "multithread.h"
 #include "util.h"
 #include "lib/simd.h"
+#ifdef WEB
+#include <emscripten.h>
+#endif
 
 typedef void (*classstatusfunc) (char *szOutput);
 typedef int (*cfunc) (const void *, const void *);
@@ -196,9 +199,65 @@ enum {
 #define NUM_RACE_INPUTS ( HALF_RACE_INPUTS * 2 )
 #define NUM_PRUNING_INPUTS (25 * MINPPERPOINT * 2)
 
+/* engine counters; the main thread shares those of worker 0, like its
+ * other thread local data */
+extern evalstats aEvalStats[MAX_NUMTHREADS];
+
+#define EVALSTATS() (&aEvalStats[MT_GetThreadID()])
+#define STATS_PLY(n) ((n) < STATS_PLIES ? (n) : STATS_PLIES - 1)
+#define STATS_NET_CLASS(pc, fPrune) ((fPrune ? STATS_NET_PRUNE_CONTACT : STATS_NET_CONTACT) + CLASS_CONTACT - (pc))
+
+static inline void
+StatsCacheLookup(int nPlies, int iClass, int fHit)
+{
+    evalstats *pes = EVALSTATS();
+
+    pes->aacCacheLookup[STATS_PLY(nPlies)][iClass]++;
+    if (fHit)
+        pes->aacCacheHit[STATS_PLY(nPlies)][iClass]++;
+}
+
+static inline void
+StatsCacheAdd(uint32_t infoDropped)
+{
+    if (infoDropped)
+        EVALSTATS()->acCacheEvict[STATS_PLY((infoDropped & 0x0f) - 1)]++;
+}
+
+/* moves scored at nPlies by the outermost FindnSaveBestMoves(), which
+ * started at t */
+static inline void
+StatsSearchPly(unsigned int nPlies, unsigned int cMoves, double t)
+{
+    evalstats *pes = EVALSTATS();
+
+    pes->acSearchMoves[STATS_PLY(nPlies)] += cMoves;
+    pes->arSearchTime[STATS_PLY(nPlies)] += get_time() - t;
+}
+
+/* checked once per roll by the plied evaluations; passing rEvalDeadline
+ * interrupts them like the user would */
+static inline int
+EvalInterrupted(void)
+{
+    if (fInterrupt)
+        return TRUE;
+
+    if (rEvalDeadline > 0.0 && get_time() >= rEvalDeadline) {
+        fEvalDeadlinePassed = TRUE;
+        fInterrupt = TRUE;
+        return TRUE;
+    }
+
+    return FALSE;
+}
 
 #if !LOCKING_VERSION
 
+evalstats aEvalStats[MAX_NUMTHREADS];
+double rEvalDeadline = 0.0;
+int fEvalDeadlinePassed = FALSE;
+
 f_FindnSaveBestMoves FindnSaveBestMoves = FindnSaveBestMovesNoLocking;
 f_FindBestMove FindBestMove = FindBestMoveNoLocking;
 f_EvaluatePosition EvaluatePosition = EvaluatePositionNoLocking;
@@ -207,17 +266,20 @@ f_GeneralCubeDecisionE GeneralCubeDecisionE = GeneralCubeDecisionENoLocking;
 f_GeneralEvaluationE GeneralEvaluationE = GeneralEvaluationENoLocking;
 
 #define FindnSaveBestMoves FindnSaveBestMovesNoLocking
+#define SearchBestMoves SearchBestMovesNoLocking
 #define FindBestMove FindBestMoveNoLocking
 #define EvaluatePosition EvaluatePositionNoLocking
 #define ScoreMove ScoreMoveNoLocking
 #define GeneralCubeDecisionE GeneralCubeDecisionENoLocking
 #define GeneralEvaluationE GeneralEvaluationENoLocking
 #define EvaluatePositionCache EvaluatePositionCacheNoLocking
+#define EvaluatePositionCacheHash EvaluatePositionCacheHashNoLocking
 #define FindBestMovePlied FindBestMovePliedNoLocking
 #define GeneralEvaluationEPlied GeneralEvaluationEPliedNoLocking
 #define EvaluatePositionCubeful3 EvaluatePositionCubeful3NoLocking
 #define ScoreMoves ScoreMovesNoLocking
 #define ScoreMovesPruned ScoreMovesPrunedNoLocking
+#define BatchEvaluateMoves BatchEvaluateMovesNoLocking
 #define FindBestMoveInEval FindBestMoveInEvalNoLocking
 #define GeneralEvaluationEPliedCubeful GeneralEvaluationEPliedCubefulNoLocking
 #define EvaluatePositionCubeful4 EvaluatePositionCubeful4NoLocking
@@ -226,6 +288,8 @@ f_GeneralEvaluationE GeneralEvaluationE = GeneralEvaluationENoLocking;
 
 static int EvaluatePositionCache(NNState * nnStates, const TanBoard anBoard, float arOutput[],
                                  cubeinfo * const pci, const evalcontext * pecx, int nPlies, positionclass pc);
+static int EvaluatePositionCacheHash(NNState * nnStates, const TanBoard anBoard, uint64_t hash, float arOutput[],
+                                     cubeinfo * const pci, const evalcontext * pecx, int nPlies, positionclass pc);
 
 static int FindBestMovePlied(int anMove[8], int nDice0, int nDice1,
                              TanBoard anBoard, const cubeinfo * pci,
@@ -240,6 +304,18 @@ neuralnet nnContact, nnRace, nnCrashed;
 
 neuralnet nnpContact, nnpRace, nnpCrashed;
 
+/* the nets in the order of the weights files */
+static neuralnet *const apnnWeights[] = { &nnContact, &nnRace, &nnCrashed, &nnpContact, &nnpCrashed, &nnpRace };
+
+/* evaluate the race, crashed and contact nets with fixed point weights */
+int fEvalQuantized = FALSE;
+
+/* generate moves from a movegenboard rather than a TanBoard */
+int fMoveGenBits = TRUE;
+
+/* let ScoreMoves() drop candidates partway through their rolls */
+int fEvalProgressive = FALSE;
+
 bearoffcontext *pbcOS = NULL;
 bearoffcontext *pbcTS = NULL;
 bearoffcontext *pbc1 = NULL;
@@ -417,18 +493,39 @@ ComputeTable0(void)
     }
 }
 
-static int
-Escapes(const unsigned int anBoard[25], int n)
+/* The made points of one side as a bit mask (bit i for point i), so
+ * that the escape counts below are a shift and a table lookup instead
+ * of a walk over the 12 points in front of the chequer.  Computed once
+ * per side and position and shared by both halves of the inputs. */
+
+static unsigned int
+MadePoints(const unsigned int anBoard[25])
 {
+    unsigned int i, f = 0;
 
-    int i, af = 0, m;
+    for (i = 0; i < 25; i++)
+        f |= (unsigned int) anPoint[anBoard[i]] << i;
 
-    m = (n < 12) ? n : 12;
+    return f;
+}
 
-    for (i = 0; i < m; i++)
-        af |= (anPoint[anBoard[24 + i - n]] << i);
+/* the points 24 - n ... 23 - n + min(n, 12) */
 
-    return anEscapes[af];
+static inline unsigned int
+EscapeMask(unsigned int fMade, int n)
+{
+    int m = (n < 12) ? n : 12;
+
+    if (m <= 0)
+        return 0;
+
+    return (fMade >> (24 - n)) & ((1u << m) - 1);
+}
+
+static int
+Escapes(unsigned int fMade, int n)
+{
+    return anEscapes[EscapeMask(fMade, n)];
 }
 
 static void
@@ -459,17 +556,9 @@ ComputeTable1(void)
 }
 
 static int
-Escapes1(const unsigned int anBoard[25], int n)
+Escapes1(unsigned int fMade, int n)
 {
-
-    int i, af = 0, m;
-
-    m = (n < 12) ? n : 12;
-
-    for (i = 0; i < m; i++)
-        af |= (anPoint[anBoard[24 + i - n]] << i);
-
-    return anEscapes1[af];
+    return anEscapes1[EscapeMask(fMade, n)];
 }
 
 
@@ -632,6 +721,7 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
         }
 
         ComputeTable();
+        PositionHashInit();
 
         rc.randrsl[0] = (ub4) time(NULL);
         for (i = 0; i < RANDSIZ; i++)
@@ -739,10 +829,12 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
     g_assert(nnpRace.cInput == NUM_PRUNING_INPUTS && nnpRace.cOutput == NUM_OUTPUTS);
 }
 
-/* Calculates inputs for any contact position, for one player only. */
+/* Calculates inputs for any contact position, for one player only.
+ * fMade and fMadeOpp are MadePoints() of anBoard and anBoardOpp. */
 
 static void
-CalculateHalfInputs(const unsigned int anBoard[25], const unsigned int anBoardOpp[25], float afInput[])
+CalculateHalfInputs(const unsigned int anBoard[25], const unsigned int anBoardOpp[25], unsigned int fMade,
+                    unsigned int fMadeOpp, float afInput[])
 {
     int i, j, k, l, nOppBack, n, aHit[39], nBoard;
 
@@ -1246,12 +1338,12 @@ CalculateHalfInputs(const unsigned int anBoard[25], const unsigned int anBoardOp
         afInput[I_P2] = n2 / 36.0f;
     }
 
-    afInput[I_BACKESCAPES] = Escapes(anBoard, 23 - nOppBack) / 36.0f;
+    afInput[I_BACKESCAPES] = Escapes(fMade, 23 - nOppBack) / 36.0f;
 
-    afInput[I_BACKRESCAPES] = Escapes1(anBoard, 23 - nOppBack) / 36.0f;
+    afInput[I_BACKRESCAPES] = Escapes1(fMade, 23 - nOppBack) / 36.0f;
 
     for (n = 36, i = 15; i < 24 - nOppBack; i++)
-        if ((j = Escapes(anBoard, i)) < n)
+        if ((j = Escapes(fMade, i)) < n)
             n = j;
 
     afInput[I_ACONTAIN] = (36 - n) / 36.0f;
@@ -1264,7 +1356,7 @@ CalculateHalfInputs(const unsigned int anBoard[25], const unsigned int anBoardOp
     }
 
     for (; i < 24; i++)
-        if ((j = Escapes(anBoard, i)) < n)
+        if ((j = Escapes(fMade, i)) < n)
             n = j;
 
 
@@ -1273,7 +1365,7 @@ CalculateHalfInputs(const unsigned int anBoard[25], const unsigned int anBoardOp
 
     for (n = 0, i = 6; i < 25; i++)
         if (anBoard[i])
-            n += (i - 5) * anBoard[i] * Escapes(anBoardOpp, i);
+            n += (i - 5) * anBoard[i] * Escapes(fMadeOpp, i);
 
     afInput[I_MOBILITY] = n / 3600.0f;
 
@@ -1532,6 +1624,8 @@ menOffNonCrashed(const unsigned int *anBoard, float *afInput)
 static void
 CalculateContactInputs(const TanBoard anBoard, float arInput[])
 {
+    unsigned int const afMade[2] = { MadePoints(anBoard[0]), MadePoints(anBoard[1]) };
+
     baseInputs(anBoard, arInput);
 
     {
@@ -1540,7 +1634,7 @@ CalculateContactInputs(const TanBoard anBoard, float arInput[])
         /* I accidentally switched sides (0 and 1) when I trained the net */
         menOffNonCrashed(anBoard[0], b + I_OFF1);
 
-        CalculateHalfInputs(anBoard[1], anBoard[0], b);
+        CalculateHalfInputs(anBoard[1], anBoard[0], afMade[1], afMade[0], b);
     }
 
     {
@@ -1548,7 +1642,7 @@ CalculateContactInputs(const TanBoard anBoard, float arInput[])
 
         menOffNonCrashed(anBoard[1], b + I_OFF1);
 
-        CalculateHalfInputs(anBoard[0], anBoard[1], b);
+        CalculateHalfInputs(anBoard[0], anBoard[1], afMade[0], afMade[1], b);
     }
 }
 
@@ -1557,6 +1651,8 @@ CalculateContactInputs(const TanBoard anBoard, float arInput[])
 static void
 CalculateCrashedInputs(const TanBoard anBoard, float arInput[])
 {
+    unsigned int const afMade[2] = { MadePoints(anBoard[0]), MadePoints(anBoard[1]) };
+
     baseInputs(anBoard, arInput);
 
     {
@@ -1564,7 +1660,7 @@ CalculateCrashedInputs(const TanBoard anBoard, float arInput[])
 
         menOffAll(anBoard[1], b + I_OFF1);
 
-        CalculateHalfInputs(anBoard[1], anBoard[0], b);
+        CalculateHalfInputs(anBoard[1], anBoard[0], afMade[1], afMade[0], b);
     }
 
     {
@@ -1572,7 +1668,7 @@ CalculateCrashedInputs(const TanBoard anBoard, float arInput[])
 
         menOffAll(anBoard[0], b + I_OFF1);
 
-        CalculateHalfInputs(anBoard[0], anBoard[1], b);
+        CalculateHalfInputs(anBoard[0], anBoard[1], afMade[0], afMade[1], b);
     }
 }
 
@@ -2095,17 +2191,28 @@ EvalRaceBG(const TanBoard anBoard, float arOutput[], const bgvariation bgv)
 }
 
 static int
-EvalRace(const TanBoard anBoard, float arOutput[], const bgvariation bgv, NNState * nnStates)
+EvaluateNet(const neuralnet * pnn, statsnet sn, float arInput[], float arOutput[], NNState * pnState)
 {
-    SSE_ALIGN(float arInput[NUM_RACE_INPUTS]);
+    EVALSTATS()->acNetEval[sn]++;
 
-    CalculateRaceInputs(anBoard, arInput);
+    if (fEvalQuantized)
+        return NeuralNetEvaluateQuantized(pnn, arInput, arOutput);
 
 #if USE_SIMD_INSTRUCTIONS
-    if (NeuralNetEvaluateSSE(&nnRace, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
+    return NeuralNetEvaluateSSE(pnn, arInput, arOutput, pnState);
 #else
-    if (NeuralNetEvaluate(&nnRace, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
+    return NeuralNetEvaluate(pnn, arInput, arOutput, pnState);
 #endif
+}
+
+static int
+EvalRace(const TanBoard anBoard, float arOutput[], const bgvariation bgv, NNState * nnStates)
+{
+    SSE_ALIGN(float arInput[NUM_RACE_INPUTS]);
+
+    CalculateRaceInputs(anBoard, arInput);
+
+    if (EvaluateNet(&nnRace, STATS_NET_RACE, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
         return -1;
 
     /* special evaluation of backgammons overrides net output */
@@ -2124,12 +2231,7 @@ EvalContact(const TanBoard anBoard, float arOutput[], const bgvariation UNUSED(b
 
     CalculateContactInputs(anBoard, arInput);
 
-#if USE_SIMD_INSTRUCTIONS
-    return NeuralNetEvaluateSSE(&nnContact, arInput, arOutput,
-                                nnStates ? nnStates + (CLASS_CONTACT - CLASS_RACE) : NULL);
-#else
-    return NeuralNetEvaluate(&nnContact, arInput, arOutput, nnStates ? nnStates + (CLASS_CONTACT - CLASS_RACE) : NULL);
-#endif
+    return EvaluateNet(&nnContact, STATS_NET_CONTACT, arInput, arOutput, nnStates ? nnStates + (CLASS_CONTACT - CLASS_RACE) : NULL);
 }
 
 static int
@@ -2139,12 +2241,7 @@ EvalCrashed(const TanBoard anBoard, float arOutput[], const bgvariation UNUSED(b
 
     CalculateCrashedInputs(anBoard, arInput);
 
-#if USE_SIMD_INSTRUCTIONS
-    return NeuralNetEvaluateSSE(&nnCrashed, arInput, arOutput,
-                                nnStates ? nnStates + (CLASS_CRASHED - CLASS_RACE) : NULL);
-#else
-    return NeuralNetEvaluate(&nnCrashed, arInput, arOutput, nnStates ? nnStates + (CLASS_CRASHED - CLASS_RACE) : NULL);
-#endif
+    return EvaluateNet(&nnCrashed, STATS_NET_CRASHED, arInput, arOutput, nnStates ? nnStates + (CLASS_CRASHED - CLASS_RACE) : NULL);
 }
 
 extern int
@@ -2234,6 +2331,138 @@ classevalfunc acef[N_CLASSES] = {
     EvalRace, EvalCrashed, EvalContact
 };
 
+/* Evaluate up to NN_BATCH_SIZE race, crashed or contact positions of
+ * the same class with a single batched neural net call.  As with
+ * acef[], the caller is responsible for the sanity check. */
+
+extern int
+EvalNeuralNetBatch(positionclass pc, unsigned int cBoards, TanBoard aanBoard[],
+                   float aarOutput[][NUM_OUTPUTS], const bgvariation bgv)
+{
+    /* rows are padded so that each of them stays SIMD aligned */
+    SSE_ALIGN(float aarInput[NN_BATCH_SIZE][(NUM_INPUTS + 7) & ~7]);
+    float *apInput[NN_BATCH_SIZE], *apOutput[NN_BATCH_SIZE];
+    neuralnet *pnn;
+    unsigned int i;
+
+    g_assert(cBoards <= NN_BATCH_SIZE);
+
+    for (i = 0; i < cBoards; i++) {
+        switch (pc) {
+        case CLASS_RACE:
+            CalculateRaceInputs((ConstTanBoard) aanBoard[i], aarInput[i]);
+            break;
+        case CLASS_CRASHED:
+            CalculateCrashedInputs((ConstTanBoard) aanBoard[i], aarInput[i]);
+            break;
+        case CLASS_CONTACT:
+            CalculateContactInputs((ConstTanBoard) aanBoard[i], aarInput[i]);
+            break;
+        default:
+            return -1;
+        }
+        apInput[i] = aarInput[i];
+        apOutput[i] = aarOutput[i];
+    }
+
+    pnn = (pc == CLASS_RACE) ? &nnRace : (pc == CLASS_CRASHED) ? &nnCrashed : &nnContact;
+    EVALSTATS()->acNetEval[STATS_NET_CLASS(pc, FALSE)] += cBoards;
+
+    if (fEvalQuantized) {
+        for (i = 0; i < cBoards; i++)
+            if (NeuralNetEvaluateQuantized(pnn, apInput[i], apOutput[i]))
+                return -1;
+    } else if (NeuralNetEvaluateBatch(pnn, cBoards, apInput, apOutput))
+        return -1;
+
+    if (pc == CLASS_RACE)
+        /* special evaluation of backgammons overrides net output */
+        for (i = 0; i < cBoards; i++)
+            EvalRaceBG((ConstTanBoard) aanBoard[i], aarOutput[i], bgv);
+
+    return 0;
+}
+
+/* Makes the fixed point copies of the main nets that quantized mode
+ * evaluates with, or with f FALSE frees them again.  Returns -1 if they
+ * cannot be made. */
+
+extern int
+EvalQuantize(int f)
+{
+    if (f && !NeuralNetQuantize(&nnContact) && !NeuralNetQuantize(&nnRace) && !NeuralNetQuantize(&nnCrashed))
+        return 0;
+
+    NeuralNetQuantizeFree(&nnContact);
+    NeuralNetQuantizeFree(&nnRace);
+    NeuralNetQuantizeFree(&nnCrashed);
+
+    return f ? -1 : 0;
+}
+
+/* Compare the quantized and floating point nets over a fixed set of
+ * positions: those met in 20 games of random moves from a fixed seed.
+ * Returns the largest difference in cubeless money equity, or -1 if the
+ * fixed point weights cannot be made. */
+
+extern float
+QuantizedEvalDeviation(unsigned int *pcPositions)
+{
+    int const fQuantized = fEvalQuantized;
+    unsigned int nRandom = 1;
+    unsigned int iGame, iTurn;
+    float rMax = 0.0f;
+    cubeinfo ci;
+
+    SetCubeInfoMoney(&ci, 1, -1, 0, FALSE, FALSE, VARIATION_STANDARD);
+    *pcPositions = 0;
+
+    if (!fQuantized && EvalQuantize(TRUE))
+        return -1.0f;
+
+#define NEXT_RANDOM() (nRandom = nRandom * 1103515245 + 12345, (nRandom >> 16) & 0x7fff)
+
+    for (iGame = 0; iGame < 20; iGame++) {
+        TanBoard anBoard;
+
+        PositionFromID(anBoard, "4HPwATDgc/ABMA");
+
+        for (iTurn = 0; iTurn < 200; iTurn++) {
+            SSE_ALIGN(float arFloat[NUM_OUTPUTS]);
+            SSE_ALIGN(float arQuantized[NUM_OUTPUTS]);
+            movecandlist ml;
+            positionclass pc;
+            int n0 = NEXT_RANDOM() % 6 + 1;
+            int n1 = NEXT_RANDOM() % 6 + 1;
+
+            if (GenerateMoves(&ml, (ConstTanBoard) anBoard, n0, n1, FALSE))
+                PositionFromKey(anBoard, &ml.amMoves[NEXT_RANDOM() % ml.cMoves].key);
+            SwapSides(anBoard);
+
+            pc = ClassifyPosition((ConstTanBoard) anBoard, VARIATION_STANDARD);
+            if (pc == CLASS_OVER)
+                break;
+            else if (pc < CLASS_RACE)
+                continue;
+
+            fEvalQuantized = FALSE;
+            acef[pc] ((ConstTanBoard) anBoard, arFloat, VARIATION_STANDARD, NULL);
+            fEvalQuantized = TRUE;
+            acef[pc] ((ConstTanBoard) anBoard, arQuantized, VARIATION_STANDARD, NULL);
+
+            rMax = MAX(rMax, fabsf(Utility(arFloat, &ci) - Utility(arQuantized, &ci)));
+            ++*pcPositions;
+        }
+    }
+#undef NEXT_RANDOM
+
+    fEvalQuantized = fQuantized;
+    if (!fQuantized)
+        EvalQuantize(FALSE);
+
+    return rMax;
+}
+
 extern float
 Noise(const evalcontext * pec, const TanBoard anBoard, int iOutput)
 {
@@ -2658,12 +2887,34 @@ ApplyMove(TanBoard anBoard, const int anMove[8], const int fCheckLegal)
     return 0;
 }
 
+/* Empty the set: every slot of an older generation is free */
+
 static void
-SaveMoves(movelist * pml, unsigned int cMoves, unsigned int cPip, int anMoves[], const TanBoard anBoard, int fPartial)
+MoveHashClear(movehash * pmh)
+{
+    if (!++pmh->nGeneration) {
+        memset(pmh->anGeneration, 0, sizeof(pmh->anGeneration));
+        pmh->nGeneration = 1;
+    }
+}
+
+static inline unsigned int
+MoveHashSlot(const positionkey * pkey)
+{
+    unsigned int i, h = 0;
+
+    for (i = 0; i < 7; i++)
+        h = (h ^ pkey->data[i]) * 0x9e3779b1u;
+
+    return (h ^ (h >> 16)) & (MOVE_HASH_SIZE - 1);
+}
+
+static void
+SaveMovesKey(movecandlist * pml, movehash * pmh, unsigned int cMoves, unsigned int cPip, int anMoves[],
+             const positionkey * pkey, uint64_t hash, int fPartial)
 {
     unsigned int i, j;
-    move *pm;
-    positionkey key;
+    movecand *pm;
 
     if (fPartial) {
         /* Save all moves, even incomplete ones */
@@ -2679,8 +2930,10 @@ SaveMoves(movelist * pml, unsigned int cMoves, unsigned int cPip, int anMoves[],
         if (cMoves < pml->cMaxMoves || cPip < pml->cMaxPips)
             return;
 
-        if (cMoves > pml->cMaxMoves || cPip > pml->cMaxPips)
+        if (cMoves > pml->cMaxMoves || cPip > pml->cMaxPips) {
             pml->cMoves = 0;
+            MoveHashClear(pmh);
+        }
 
         pml->cMaxMoves = cMoves;
         pml->cMaxPips = cPip;
@@ -2688,12 +2941,10 @@ SaveMoves(movelist * pml, unsigned int cMoves, unsigned int cPip, int anMoves[],
 
     pm = pml->amMoves + pml->cMoves;
 
-    PositionKey(anBoard, &key);
-
-    for (i = 0; i < pml->cMoves; i++) {
-        move *pm = &(pml->amMoves[i]);
+    for (i = MoveHashSlot(pkey); pmh->anGeneration[i] == pmh->nGeneration; i = (i + 1) & (MOVE_HASH_SIZE - 1)) {
+        movecand *pm = &(pml->amMoves[pmh->aiMove[i]]);
 
-        if (EqualKeys(key, pm->key)) {
+        if (EqualKeys((*pkey), pm->key)) {
             if (cMoves > pm->cMoves || cPip > pm->cPips) {
                 for (j = 0; j < cMoves * 2; j++)
                     pm->anMove[j] = anMoves[j] > -1 ? anMoves[j] : -1;
@@ -2709,17 +2960,20 @@ SaveMoves(movelist * pml, unsigned int cMoves, unsigned int cPip, int anMoves[],
         }
     }
 
-    for (i = 0; i < cMoves * 2; i++)
-        pm->anMove[i] = anMoves[i] > -1 ? anMoves[i] : -1;
+    for (j = 0; j < cMoves * 2; j++)
+        pm->anMove[j] = anMoves[j] > -1 ? anMoves[j] : -1;
 
     if (cMoves < 4)
         pm->anMove[cMoves * 2] = -1;
 
-    CopyKey(key, pm->key);
+    CopyKey((*pkey), pm->key);
+    pm->hash = hash;
+
+    pmh->anGeneration[i] = pmh->nGeneration;
+    pmh->aiMove[i] = (unsigned short) pml->cMoves;
 
     pm->cMoves = cMoves;
     pm->cPips = cPip;
-    pm->cmark = CMARK_NONE;
 
     for (i = 0; i < NUM_OUTPUTS; i++)
         pm->arEvalMove[i] = 0.0;
@@ -2729,6 +2983,20 @@ SaveMoves(movelist * pml, unsigned int cMoves, unsigned int cPip, int anMoves[],
     g_assert(pml->cMoves < MAX_INCOMPLETE_MOVES);
 }
 
+static void
+SaveMoves(movecandlist * pml, movehash * pmh, unsigned int cMoves, unsigned int cPip, int anMoves[],
+          const TanBoard anBoard, int fPartial)
+{
+    positionkey key;
+
+    /* don't bother computing the key of a move that will be rejected */
+    if (!fPartial && (cMoves < pml->cMaxMoves || cPip < pml->cMaxPips))
+        return;
+
+    PositionKey(anBoard, &key);
+    SaveMovesKey(pml, pmh, cMoves, cPip, anMoves, &key, PositionHash(anBoard), fPartial);
+}
+
 static int
 LegalMove(const TanBoard anBoard, int iSrc, int nPips)
 {
@@ -2749,7 +3017,7 @@ LegalMove(const TanBoard anBoard, int iSrc, int nPips)
 }
 
 static int
-GenerateMovesSub(movelist * pml, int anRoll[], int nMoveDepth,
+GenerateMovesSub(movecandlist * pml, movehash * pmh, int anRoll[], int nMoveDepth,
                  int iPip, int cPip, const TanBoard anBoard, int anMoves[], int fPartial)
 {
     int i, fUsed = 0;
@@ -2772,9 +3040,9 @@ GenerateMovesSub(movelist * pml, int anRoll[], int nMoveDepth,
 
         ApplySubMove(anBoardNew, 24, anRoll[nMoveDepth], TRUE);
 
-        if (GenerateMovesSub(pml, anRoll, nMoveDepth + 1, 23, cPip +
+        if (GenerateMovesSub(pml, pmh, anRoll, nMoveDepth + 1, 23, cPip +
                              anRoll[nMoveDepth], (ConstTanBoard) anBoardNew, anMoves, fPartial))
-            SaveMoves(pml, nMoveDepth + 1, cPip + anRoll[nMoveDepth], anMoves, (ConstTanBoard) anBoardNew, fPartial);
+            SaveMoves(pml, pmh, nMoveDepth + 1, cPip + anRoll[nMoveDepth], anMoves, (ConstTanBoard) anBoardNew, fPartial);
 
         return fPartial;
     } else {
@@ -2787,10 +3055,10 @@ GenerateMovesSub(movelist * pml, int anRoll[], int nMoveDepth,
 
                 ApplySubMove(anBoardNew, i, anRoll[nMoveDepth], TRUE);
 
-                if (GenerateMovesSub(pml, anRoll, nMoveDepth + 1,
+                if (GenerateMovesSub(pml, pmh, anRoll, nMoveDepth + 1,
                                      anRoll[0] == anRoll[1] ? i : 23,
                                      cPip + anRoll[nMoveDepth], (ConstTanBoard) anBoardNew, anMoves, fPartial))
-                    SaveMoves(pml, nMoveDepth + 1, cPip +
+                    SaveMoves(pml, pmh, nMoveDepth + 1, cPip +
                               anRoll[nMoveDepth], anMoves, (ConstTanBoard) anBoardNew, fPartial);
 
                 fUsed = 1;
@@ -2800,6 +3068,143 @@ GenerateMovesSub(movelist * pml, int anRoll[], int nMoveDepth,
     return !fUsed || fPartial;
 }
 
+/* The board as seen by the move generator: the position key and
+ * PositionHash(), kept up to date as chequers are moved (the key
+ * doubles as the chequer counts, 4 bits per point), and bit masks
+ * indexed by the points of the player on roll.  It is 48 bytes to copy
+ * at each level of the recursion instead of the 200 of a TanBoard,
+ * finding the next chequer to move or the back chequer is a bit scan,
+ * and a finished move need not be keyed or hashed. */
+
+typedef struct {
+    positionkey key;
+    uint64_t hash;
+    unsigned int fMen;          /* points 0-24 holding chequers of the player on roll */
+    unsigned int fBlocked;      /* points 0-23 made by the opponent */
+    unsigned int fBlot;         /* points 0-23 holding an opponent blot */
+} movegenboard;
+
+/* position of the count of point i (0-24) of side 1 (player on roll)
+ * or side 0 in the key, as in PositionKey() */
+
+#define KEY_WORD(side, i) ((i) == 24 ? 6 : (i) / 8 + ((side) ? 0 : 3))
+#define KEY_SHIFT(side, i) ((i) == 24 ? ((side) ? 4 : 0) : ((i) % 8) * 4)
+
+static void
+MoveGenBoard(movegenboard * pmb, const TanBoard anBoard)
+{
+    unsigned int i;
+
+    PositionKey(anBoard, &pmb->key);
+    pmb->hash = PositionHash(anBoard);
+
+    pmb->fMen = pmb->fBlocked = pmb->fBlot = 0;
+
+    for (i = 0; i < 25; i++)
+        if (anBoard[1][i])
+            pmb->fMen |= 1u << i;
+
+    for (i = 0; i < 24; i++)
+        if (anBoard[0][23 - i] > 1)
+            pmb->fBlocked |= 1u << i;
+        else if (anBoard[0][23 - i] == 1)
+            pmb->fBlot |= 1u << i;
+}
+
+/* ApplySubMove() for a legal move on a movegenboard */
+
+static inline void
+MoveGenSubMove(movegenboard * pmb, int iSrc, int nRoll)
+{
+    int const iDest = iSrc - nRoll;
+    unsigned int *pw = &pmb->key.data[KEY_WORD(1, iSrc)];
+    int const nShift = KEY_SHIFT(1, iSrc);
+    unsigned int n = (*pw >> nShift) & 0x0f;
+
+    *pw -= 1u << nShift;
+    pmb->hash ^= ZobristPoint(1, iSrc, n) ^ ZobristPoint(1, iSrc, n - 1);
+    if (n == 1)
+        pmb->fMen &= ~(1u << iSrc);
+
+    if (iDest < 0)
+        return;
+
+    if (pmb->fBlot & (1u << iDest)) {
+        n = (pmb->key.data[KEY_WORD(0, 24)] >> KEY_SHIFT(0, 24)) & 0x0f;
+        pmb->key.data[KEY_WORD(0, 23 - iDest)] -= 1u << KEY_SHIFT(0, 23 - iDest);
+        pmb->key.data[KEY_WORD(0, 24)] += 1u << KEY_SHIFT(0, 24);
+        pmb->hash ^= ZobristPoint(0, 23 - iDest, 1) ^ ZobristPoint(0, 24, n) ^ ZobristPoint(0, 24, n + 1);
+        pmb->fBlot &= ~(1u << iDest);
+    }
+
+    pw = &pmb->key.data[KEY_WORD(1, iDest)];
+    n = (*pw >> KEY_SHIFT(1, iDest)) & 0x0f;
+    *pw += 1u << KEY_SHIFT(1, iDest);
+    pmb->hash ^= ZobristPoint(1, iDest, n) ^ ZobristPoint(1, iDest, n + 1);
+    pmb->fMen |= 1u << iDest;
+}
+
+/* GenerateMovesSub() on a movegenboard; it visits the moves in the same
+ * order, so the movelist is identical */
+
+static int
+GenerateMovesBitsSub(movecandlist * pml, movehash * pmh, int anRoll[], int nMoveDepth,
+                     int iPip, int cPip, const movegenboard * pmb, int anMoves[], int fPartial)
+{
+    int i, fUsed = 0;
+    unsigned int f;
+    int nRoll;
+    movegenboard mbNew;
+
+    if (nMoveDepth > 3 || !anRoll[nMoveDepth])
+        return TRUE;
+
+    nRoll = anRoll[nMoveDepth];
+
+    if (pmb->fMen & (1u << 24)) {       /* on bar */
+        if (pmb->fBlocked & (1u << (24 - nRoll)))
+            return TRUE;
+
+        anMoves[nMoveDepth * 2] = 24;
+        anMoves[nMoveDepth * 2 + 1] = 24 - nRoll;
+
+        mbNew = *pmb;
+        MoveGenSubMove(&mbNew, 24, nRoll);
+
+        if (GenerateMovesBitsSub(pml, pmh, anRoll, nMoveDepth + 1, 23, cPip + nRoll, &mbNew, anMoves, fPartial))
+            SaveMovesKey(pml, pmh, nMoveDepth + 1, cPip + nRoll, anMoves, &mbNew.key, mbNew.hash, fPartial);
+
+        return fPartial;
+    }
+
+    for (f = pmb->fMen & ((2u << iPip) - 1); f; f &= ~(1u << i)) {
+        i = msb32(f);
+
+        if (i < nRoll) {
+            /* bearing off: from the back chequer, or exactly */
+            int const nBack = msb32(pmb->fMen);
+
+            if (nBack > 5 || (i != nBack && i != nRoll - 1))
+                continue;
+        } else if (pmb->fBlocked & (1u << (i - nRoll)))
+            continue;
+
+        anMoves[nMoveDepth * 2] = i;
+        anMoves[nMoveDepth * 2 + 1] = i - nRoll;
+
+        mbNew = *pmb;
+        MoveGenSubMove(&mbNew, i, nRoll);
+
+        if (GenerateMovesBitsSub(pml, pmh, anRoll, nMoveDepth + 1,
+                                 anRoll[0] == anRoll[1] ? i : 23, cPip + nRoll, &mbNew, anMoves, fPartial))
+            SaveMovesKey(pml, pmh, nMoveDepth + 1, cPip + nRoll, anMoves, &mbNew.key, mbNew.hash, fPartial);
+
+        fUsed = 1;
+    }
+
+    return !fUsed || fPartial;
+}
+
 extern int
 CompareMoves(const move * pm0, const move * pm1)
 {
@@ -2852,11 +3257,13 @@ CompareMovesGeneral(const move * pm0, const move * pm1)
     return (back[0] > back[1] ? 1 : -1);
 }
 
-extern int
-GenerateMoves(movelist * pml, const TanBoard anBoard, int n0, int n1, int fPartial)
+static int
+GenerateMovesGeneric(movecandlist * pml, const TanBoard anBoard, int n0, int n1, int fPartial, int fBits)
 {
 
     int anRoll[4], anMoves[8];
+    movehash *pmh = MT_Get_MoveHash();
+    movegenboard mb;
     anRoll[0] = n0;
     anRoll[1] = n1;
 
@@ -2864,17 +3271,200 @@ GenerateMoves(movelist * pml, const TanBoard anBoard, int n0, int n1, int fParti
 
     pml->cMoves = pml->cMaxMoves = pml->cMaxPips = pml->iMoveBest = 0;
     pml->amMoves = MT_Get_aMoves();
-    GenerateMovesSub(pml, anRoll, 0, 23, 0, anBoard, anMoves, fPartial);
+    MoveHashClear(pmh);
+
+    if (fBits) {
+        MoveGenBoard(&mb, anBoard);
+        GenerateMovesBitsSub(pml, pmh, anRoll, 0, 23, 0, &mb, anMoves, fPartial);
+    } else
+        GenerateMovesSub(pml, pmh, anRoll, 0, 23, 0, anBoard, anMoves, fPartial);
 
     if (anRoll[0] != anRoll[1]) {
         swap(anRoll, anRoll + 1);
 
-        GenerateMovesSub(pml, anRoll, 0, 23, 0, anBoard, anMoves, fPartial);
+        if (fBits)
+            GenerateMovesBitsSub(pml, pmh, anRoll, 0, 23, 0, &mb, anMoves, fPartial);
+        else
+            GenerateMovesSub(pml, pmh, anRoll, 0, 23, 0, anBoard, anMoves, fPartial);
     }
 
     return pml->cMoves;
 }
 
+extern int
+GenerateMoves(movecandlist * pml, const TanBoard anBoard, int n0, int n1, int fPartial)
+{
+    evalstats *pes = EVALSTATS();
+    int cMoves = GenerateMovesGeneric(pml, anBoard, n0, n1, fPartial, fMoveGenBits);
+
+    pes->cMoveGen++;
+    pes->cMovesGenerated += cMoves;
+
+    return cMoves;
+}
+
+/* A random position for the self-checks below: any number of chequers
+ * of each side on the bar, the points or borne off.  *pnRandom is the
+ * state of the generator, so that the checks are reproducible. */
+
+static void
+RandomBoard(TanBoard anBoard, unsigned int *pnRandom)
+{
+    unsigned int nRandom = *pnRandom;
+    unsigned int nMax;
+    int i;
+
+#define NEXT_RANDOM() (nRandom = nRandom * 1103515245 + 12345, (nRandom >> 16) & 0x7fff)
+
+    memset(anBoard, 0, sizeof(TanBoard));
+
+    /* each chequer on a random point below nMax, or off, so that
+     * bearoffs are as well covered as contact positions */
+    nMax = NEXT_RANDOM() % 25 + 1;
+    for (i = 0; i < 15; i++) {
+        unsigned int n = NEXT_RANDOM() % (nMax + 1);
+
+        if (n < nMax)
+            anBoard[0][n]++;
+    }
+    nMax = NEXT_RANDOM() % 25 + 1;
+    for (i = 0; i < 15; i++) {
+        unsigned int n = NEXT_RANDOM() % (nMax + 1);
+
+        if (n < 24 && anBoard[0][23 - n])
+            n = 24;
+        if (n < nMax || n == 24)
+            anBoard[1][n]++;
+    }
+#undef NEXT_RANDOM
+
+    *pnRandom = nRandom;
+}
+
+/* Cross check the two move generators on cPositions random positions,
+ * for all 21 rolls, generating both complete and partial moves.
+ * Returns the number of movelists that differ in any way. */
+
+extern unsigned int
+MoveGenMismatches(unsigned int cPositions)
+{
+    unsigned int nRandom = 1;
+    unsigned int iPosition, cMismatches = 0;
+    movecand *amMoves = g_new(movecand, MAX_INCOMPLETE_MOVES);
+
+    for (iPosition = 0; iPosition < cPositions; iPosition++) {
+        TanBoard anBoard;
+        int n0, n1, fPartial;
+
+        RandomBoard(anBoard, &nRandom);
+
+        for (n0 = 1; n0 <= 6; n0++)
+            for (n1 = 1; n1 <= n0; n1++)
+                for (fPartial = 0; fPartial < 2; fPartial++) {
+                    movecandlist ml, mlBits;
+                    unsigned int j;
+                    int k, fDiffer;
+
+                    GenerateMovesGeneric(&ml, (ConstTanBoard) anBoard, n0, n1, fPartial, FALSE);
+                    memcpy(amMoves, ml.amMoves, ml.cMoves * sizeof(movecand));
+                    GenerateMovesGeneric(&mlBits, (ConstTanBoard) anBoard, n0, n1, fPartial, TRUE);
+
+                    fDiffer = ml.cMoves != mlBits.cMoves || ml.cMaxMoves != mlBits.cMaxMoves
+                        || ml.cMaxPips != mlBits.cMaxPips;
+
+                    for (j = 0; j < ml.cMoves && !fDiffer; j++) {
+                        const movecand *pm = &amMoves[j], *pmBits = &mlBits.amMoves[j];
+
+                        fDiffer = !EqualKeys(pm->key, pmBits->key) || pm->hash != pmBits->hash
+                            || pm->cMoves != pmBits->cMoves || pm->cPips != pmBits->cPips;
+
+                        for (k = 0; k < 8 && k <= 2 * pm->cMoves && !fDiffer; k++)
+                            fDiffer = pm->anMove[k] != pmBits->anMove[k];
+                    }
+
+                    cMismatches += fDiffer;
+                }
+    }
+
+    g_free(amMoves);
+
+    return cMismatches;
+}
+
+/* Check the escape table indices taken from MadePoints() against the
+ * walk over the board they replaced, for both sides and every n from
+ * -1 to 24, on cBoards random positions.  Also times the contact
+ * inputs and the contact net on 100000 random contact positions, in
+ * milliseconds per position.  Returns the number of positions with any index
+ * differing. */
+
+extern unsigned int
+EscapeMaskMismatches(unsigned int cBoards, double *prInputs, double *prNet)
+{
+    unsigned int nRandom = 1;
+    unsigned int iBoard, cMismatches = 0, cTimed = 0;
+    float *arInput = g_new(float, 1000 * NUM_INPUTS);
+    TanBoard *aanBoard = g_new(TanBoard, 1000);
+    float arOutput[NUM_OUTPUTS];
+
+    *prInputs = *prNet = 0.0;
+
+    for (iBoard = 0; iBoard < cBoards; iBoard++) {
+        TanBoard anBoard;
+        int iSide, n, i, fDiffer = FALSE;
+
+        RandomBoard(anBoard, &nRandom);
+
+        for (iSide = 0; iSide < 2; iSide++) {
+            unsigned int const fMade = MadePoints(anBoard[iSide]);
+
+            for (n = -1; n <= 24; n++) {
+                unsigned int af = 0;
+
+                for (i = 0; i < (n < 12 ? n : 12); i++)
+                    af |= (unsigned int) anPoint[anBoard[iSide][24 + i - n]] << i;
+
+                fDiffer |= EscapeMask(fMade, n) != af;
+            }
+        }
+
+        cMismatches += fDiffer;
+    }
+
+    /* the inputs of 1000 positions at a time, then the net on them */
+    for (nRandom = 1; cTimed < 100000 && cTimed < cBoards; cTimed += 1000) {
+        double t;
+
+        for (iBoard = 0; iBoard < 1000; iBoard++)
+            do
+                RandomBoard(aanBoard[iBoard], &nRandom);
+            while (ClassifyPosition((ConstTanBoard) aanBoard[iBoard], VARIATION_STANDARD) != CLASS_CONTACT);
+
+        t = get_time();
+
+        for (iBoard = 0; iBoard < 1000; iBoard++)
+            CalculateContactInputs((ConstTanBoard) aanBoard[iBoard], arInput + iBoard * NUM_INPUTS);
+
+        *prInputs += get_time() - t;
+        t = get_time();
+
+        for (iBoard = 0; iBoard < 1000; iBoard++)
+            NeuralNetEvaluate(&nnContact, arInput + iBoard * NUM_INPUTS, arOutput, NULL);
+
+        *prNet += get_time() - t;
+    }
+
+    if (cTimed) {
+        *prInputs /= cTimed;
+        *prNet /= cTimed;
+    }
+
+    g_free(aanBoard);
+    g_free(arInput);
+
+    return cMismatches;
+}
+
 
 extern float
 KleinmanCount(int nPipOnRoll, int nPipNotOnRoll)
@@ -3018,7 +3608,7 @@ StatusNeuralNet(neuralnet * pnn, char *szTitle, char *sz)
 {
     char buf[200];
     sz += sprintf(sz, " * %s %s:\n", szTitle, _("neural network evaluator"));
-    sprintf(buf, _("version %s, %d inputs, %d hidden units"), WEIGHTS_VERSION, pnn->cInput, pnn->cHidden);
+    sprintf(buf, _("version %s, %d inputs, %d hidden units"), WEIGHTS_VERSION, pnn->cInput, pnn->cHiddenTrained);
     sprintf(sz, "   - %s.\n\n", buf);
 }
 
@@ -3127,19 +3717,196 @@ GetCubeRecommendation(const cubedecision cd)
     default:
         return _("Unknown cube decision");
     }
-}
+}
+
+
+extern void
+EvalCacheFlush(void)
+{
+    CacheFlush(&cEval);
+}
+
+void
+CommandClearCache(char *UNUSED(sz))
+{
+    EvalCacheFlush();
+}
+
+extern void
+CommandClearStatistics(char *UNUSED(sz))
+{
+    EvalStatsReset();
+}
+
+/* Cache snapshots ("save cache" and "load cache") are a header and the
+ * CacheSnapshot() records, in the byte order of the machine that wrote
+ * them.  Evaluations are only good for the nets and the keys they were
+ * stored with, so the header identifies both. */
+
+#define CACHE_SNAPSHOT_MAGIC "GNUBGEC"
+#define CACHE_SNAPSHOT_VERSION 2
+#define CACHE_SNAPSHOT_BYTEORDER 0x01020304
+
+/* Change when EvalKey(), PositionHash() or GetHash() change the key an
+ * evaluation is stored under */
+#define EVAL_KEY_SCHEME 1
+
+typedef struct _cachesnapshotheader {
+    char szMagic[8];
+    uint32_t nVersion;
+    uint32_t nByteOrder;
+    uint32_t nKeyScheme;
+    uint32_t fQuantized;
+    uint64_t nZobrist;          /* xor of aanZobrist */
+    unsigned char auchWeights[16];      /* md5 of the output layers */
+    char szWeightsVersion[8];
+    uint32_t nBuckets;
+    uint32_t cRecords;
+} cachesnapshotheader;
+
+static void
+CacheSnapshotHeader(cachesnapshotheader * ph, uint32_t cRecords)
+{
+    struct md5_ctx ctx;
+    unsigned int i, j;
+
+    memset(ph, 0, sizeof(*ph));
+    strcpy(ph->szMagic, CACHE_SNAPSHOT_MAGIC);
+    ph->nVersion = CACHE_SNAPSHOT_VERSION;
+    ph->nByteOrder = CACHE_SNAPSHOT_BYTEORDER;
+    ph->nKeyScheme = EVAL_KEY_SCHEME;
+    ph->fQuantized = (uint32_t) fEvalQuantized;
+
+    for (i = 0; i < 25; i++)
+        for (j = 0; j < 16; j++)
+            ph->nZobrist ^= aanZobrist[i][j];
+
+    md5_init_ctx(&ctx);
+    for (i = 0; i < G_N_ELEMENTS(apnnWeights); i++) {
+        const neuralnet *pnn = apnnWeights[i];
+
+        md5_process_bytes(pnn->arOutputWeight, pnn->cHidden * pnn->cOutput * sizeof(float), &ctx);
+        md5_process_bytes(pnn->arOutputThreshold, pnn->cOutput * sizeof(float), &ctx);
+    }
+    md5_finish_ctx(&ctx, ph->auchWeights);
+
+    strncpy(ph->szWeightsVersion, WEIGHTS_VERSION, sizeof(ph->szWeightsVersion) - 1);
+    ph->nBuckets = cEval.hashMask + 1;
+    ph->cRecords = cRecords;
+}
+
+extern void
+CommandSaveCache(char *sz)
+{
+    FILE *pf;
+    cacheRecord *ar;
+    cachesnapshotheader h;
+    unsigned int c;
+
+    sz = NextToken(&sz);
+
+    if (!sz || !*sz) {
+        outputl(_("You must specify a file to save to (see `help save cache')."));
+        return;
+    }
+
+    if (!confirmOverwrite(sz, fConfirmSave))
+        return;
+
+    if (!(ar = g_try_malloc((cEval.hashMask + 1) * CACHE_WAYS * sizeof(*ar)))) {
+        outputl(_("Not enough memory to save the cache."));
+        return;
+    }
+
+    c = CacheSnapshot(&cEval, ar);
+    CacheSnapshotHeader(&h, c);
+
+    if (!(pf = g_fopen(sz, "wb"))) {
+        outputerr(sz);
+        g_free(ar);
+        return;
+    }
+
+    if (fwrite(&h, sizeof(h), 1, pf) != 1 || fwrite(ar, sizeof(*ar), c, pf) != c)
+        outputerr(sz);
+    else
+        outputf(_("%u cache entries saved to %s.\n"), c, sz);
+
+    fclose(pf);
+    g_free(ar);
+
+#ifdef WEB
+    /* write the file through to IndexedDB, if it is on a persistent mount */
+    EM_ASM({
+           FS.syncfs(false, function(err) {
+                     if (err) console.log(err);});
+           });
+#endif
+}
+
+extern void
+CommandLoadCache(char *sz)
+{
+    FILE *pf;
+    cacheRecord *ar;
+    cachesnapshotheader h, hFile;
+    unsigned int c;
+
+    sz = NextToken(&sz);
+
+    if (!sz || !*sz) {
+        outputl(_("You must specify a file to load from."));
+        return;
+    }
+
+    if (!(pf = g_fopen(sz, "rb"))) {
+        outputerr(sz);
+        return;
+    }
 
+    if (fread(&hFile, sizeof(hFile), 1, pf) != 1 || memcmp(hFile.szMagic, CACHE_SNAPSHOT_MAGIC, sizeof(hFile.szMagic))
+        || hFile.nVersion != CACHE_SNAPSHOT_VERSION || hFile.nByteOrder != CACHE_SNAPSHOT_BYTEORDER
+        || hFile.nBuckets == 0 || (hFile.nBuckets & (hFile.nBuckets - 1))
+        || hFile.cRecords > (uint64_t) hFile.nBuckets * CACHE_WAYS) {
+        outputf(_("%s is not a cache file saved by this version of GNU Backgammon.\n"), sz);
+        fclose(pf);
+        return;
+    }
 
-extern void
-EvalCacheFlush(void)
-{
-    CacheFlush(&cEval);
-}
+    CacheSnapshotHeader(&h, hFile.cRecords);
+    if (hFile.nKeyScheme != h.nKeyScheme || hFile.nZobrist != h.nZobrist
+        || memcmp(hFile.auchWeights, h.auchWeights, sizeof(h.auchWeights))
+        || strncmp(hFile.szWeightsVersion, h.szWeightsVersion, sizeof(h.szWeightsVersion))
+        || hFile.fQuantized != h.fQuantized) {
+        outputf(_("%s was saved with other neural net weights or evaluation settings.\n"), sz);
+        fclose(pf);
+        return;
+    }
 
-void
-CommandClearCache(char *UNUSED(sz))
-{
-    EvalCacheFlush();
+    /* the entries only know the bucket they were in */
+    if (hFile.nBuckets < h.nBuckets) {
+        outputf(_("%s was saved from a cache of %u entries, "
+                  "it can only be loaded into a cache of that size or smaller.\n"),
+                sz, hFile.nBuckets * CACHE_WAYS);
+        fclose(pf);
+        return;
+    }
+
+    if (!(ar = g_try_malloc((hFile.cRecords ? hFile.cRecords : 1) * sizeof(*ar)))) {
+        outputl(_("Not enough memory to load the cache."));
+        fclose(pf);
+        return;
+    }
+
+    if (fread(ar, sizeof(*ar), hFile.cRecords, pf) != hFile.cRecords)
+        outputf(_("%s is truncated.\n"), sz);
+    else {
+        c = CacheRestore(&cEval, ar, hFile.cRecords);
+        outputf(_("%u of %u cache entries loaded from %s.\n"), c, hFile.cRecords, sz);
+    }
+
+    fclose(pf);
+    g_free(ar);
 }
 
 extern double
@@ -3178,7 +3945,7 @@ GetCacheMB(int size)
     if (size <= 0)
         return 0;
     else
-        return (1 << (size + 15)) * sizeof(cacheNode) / (1024 * 1024);
+        return (1 << (size + 16)) / CACHE_WAYS * sizeof(cacheNode) / (1024 * 1024);
 }
 
 extern int
@@ -3191,11 +3958,105 @@ EvalCacheResize(unsigned int cNew)
 extern int
 EvalCacheStats(unsigned int *pcUsed, unsigned int *pcLookup, unsigned int *pcHit)
 {
-    CacheStats(&cEval, pcLookup, pcHit, pcUsed);
-    CacheStats(&cpEval, pcLookup + 1, pcHit + 1, pcUsed + 1);
+    evalstats es;
+    int i, j;
+
+    EvalStatsSum(&es);
+
+    pcLookup[0] = pcHit[0] = 0;
+    for (i = 0; i < STATS_PLIES; i++)
+        for (j = 0; j < STATS_CLASSES; j++) {
+            pcLookup[0] += (unsigned int) es.aacCacheLookup[i][j];
+            pcHit[0] += (unsigned int) es.aacCacheHit[i][j];
+        }
+    pcLookup[1] = (unsigned int) es.cPruneLookup;
+    pcHit[1] = (unsigned int) es.cPruneHit;
+
+    pcUsed[0] = CacheUsed(&cEval);
+    pcUsed[1] = CacheUsed(&cpEval);
     return 0;
 }
 
+extern void
+EvalStatsSum(evalstats * pes)
+{
+    unsigned int iThread;
+    int i, j;
+
+    memset(pes, 0, sizeof(*pes));
+
+    for (iThread = 0; iThread < MAX_NUMTHREADS; iThread++) {
+        const evalstats *p = &aEvalStats[iThread];
+
+        for (i = 0; i < STATS_PLIES; i++) {
+            for (j = 0; j < STATS_CLASSES; j++) {
+                pes->aacCacheLookup[i][j] += p->aacCacheLookup[i][j];
+                pes->aacCacheHit[i][j] += p->aacCacheHit[i][j];
+            }
+            pes->acCacheEvict[i] += p->acCacheEvict[i];
+            pes->acSearchMoves[i] += p->acSearchMoves[i];
+            pes->arSearchTime[i] += p->arSearchTime[i];
+            pes->acProgressiveMoves[i] += p->acProgressiveMoves[i];
+            pes->acProgressiveDropped[i] += p->acProgressiveDropped[i];
+            pes->acProgressiveSkipped[i] += p->acProgressiveSkipped[i];
+        }
+        pes->cPruneLookup += p->cPruneLookup;
+        pes->cPruneHit += p->cPruneHit;
+        for (i = 0; i < STATS_NETS; i++)
+            pes->acNetEval[i] += p->acNetEval[i];
+        pes->cMoveGen += p->cMoveGen;
+        pes->cMovesGenerated += p->cMovesGenerated;
+        for (i = 0; i < STATS_PHASES; i++) {
+            pes->acPhase[i] += p->acPhase[i];
+            pes->arPhaseTime[i] += p->arPhaseTime[i];
+        }
+    }
+}
+
+extern void
+EvalStatsReset(void)
+{
+    unsigned int iThread;
+    int i;
+
+    /* keep the depths of any phase in progress */
+    for (iThread = 0; iThread < MAX_NUMTHREADS; iThread++) {
+        evalstats *p = &aEvalStats[iThread];
+        unsigned int anDepth[STATS_PHASES];
+
+        for (i = 0; i < STATS_PHASES; i++)
+            anDepth[i] = p->anPhaseDepth[i];
+        memset(p, 0, sizeof(*p));
+        for (i = 0; i < STATS_PHASES; i++)
+            p->anPhaseDepth[i] = anDepth[i];
+    }
+}
+
+/* Phases nest, in the same thread or not: a rollout includes the
+ * chequer play and cube decisions it makes.  Only the outermost call of
+ * a phase in a thread is counted and timed. */
+
+extern double
+EvalStatsPhaseStart(statsphase sp)
+{
+    evalstats *pes = EVALSTATS();
+
+    if (pes->anPhaseDepth[sp]++)
+        return 0.0;
+
+    pes->acPhase[sp]++;
+    return get_time();
+}
+
+extern void
+EvalStatsPhaseEnd(statsphase sp, double t)
+{
+    evalstats *pes = EVALSTATS();
+
+    if (!--pes->anPhaseDepth[sp])
+        pes->arPhaseTime[sp] += get_time() - t;
+}
+
 extern int
 SetCubeInfoMoney(cubeinfo * pci, const int nCube, const int fCubeOwner,
                  const int fMove, const int fJacoby, const int fBeavers, const bgvariation bgv)
@@ -5213,17 +6074,20 @@ DoubleType(const int fDoubled, const int fMove, const int fTurn)
 #else
 
 #define FindnSaveBestMoves FindnSaveBestMovesWithLocking
+#define SearchBestMoves SearchBestMovesWithLocking
 #define FindBestMove FindBestMoveWithLocking
 #define EvaluatePosition EvaluatePositionWithLocking
 #define ScoreMove ScoreMoveWithLocking
 #define GeneralCubeDecisionE GeneralCubeDecisionEWithLocking
 #define GeneralEvaluationE GeneralEvaluationEWithLocking
 #define EvaluatePositionCache EvaluatePositionCacheWithLocking
+#define EvaluatePositionCacheHash EvaluatePositionCacheHashWithLocking
 #define FindBestMovePlied FindBestMovePliedWithLocking
 #define GeneralEvaluationEPlied GeneralEvaluationEPliedWithLocking
 #define EvaluatePositionCubeful3 EvaluatePositionCubeful3WithLocking
 #define ScoreMoves ScoreMovesWithLocking
 #define ScoreMovesPruned ScoreMovesPrunedWithLocking
+#define BatchEvaluateMoves BatchEvaluateMovesWithLocking
 #define FindBestMoveInEval FindBestMoveInEvalWithLocking
 #define GeneralEvaluationEPliedCubeful GeneralEvaluationEPliedCubefulWithLocking
 #define EvaluatePositionCubeful4 EvaluatePositionCubeful4WithLocking
@@ -5232,6 +6096,8 @@ DoubleType(const int fDoubled, const int fMove, const int fTurn)
 
 static int EvaluatePositionCache(NNState * nnStates, const TanBoard anBoard, float arOutput[],
                                  cubeinfo * const pci, const evalcontext * pecx, int nPlies, positionclass pc);
+static int EvaluatePositionCacheHash(NNState * nnStates, const TanBoard anBoard, uint64_t hash, float arOutput[],
+                                     cubeinfo * const pci, const evalcontext * pecx, int nPlies, positionclass pc);
 
 static int FindBestMovePlied(int anMove[8], int nDice0, int nDice1,
                              TanBoard anBoard, const cubeinfo * pci,
@@ -5247,19 +6113,27 @@ static int EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard,
 
 /* Functions that have both locking and non-locking versions below here */
 
-static int ScoreMoves(movelist * pml, const cubeinfo * pci, const evalcontext * pec, int nPlies);
-static int ScoreMovesPruned(movelist * pml, const cubeinfo * pci, const evalcontext * pec, unsigned int *bmovesi);
+static int ScoreMoves(movecandlist * pml, const cubeinfo * pci, const evalcontext * pec, int nPlies);
+static int ScoreMovesPruned(movecandlist * pml, const cubeinfo * pci, const evalcontext * pec, unsigned int *bmovesi);
+static int SearchBestMoves(movecandlist * pml, int nDice0, int nDice1, const TanBoard anBoard, positionkey * keyMove,
+                           const float rThr, const cubeinfo * pci, const evalcontext * pec,
+                           movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES]);
 
 #define PRUNE_MOVES 10
 
+/* Also leaves PositionHash() of anBoardOut in *phashOut if a move was
+ * made and phashOut is not NULL */
+
 static SIMD_AVX_STACKALIGN void
 FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const TanBoard anBoardIn,
-                   TanBoard anBoardOut, cubeinfo * const pci, const evalcontext * pec)
+                   TanBoard anBoardOut, uint64_t * phashOut, cubeinfo * const pci, const evalcontext * pec)
 {
     unsigned int i;
-    movelist ml;
+    movecandlist ml;
     positionclass evalClass = 0;
     unsigned int bmovesi[PRUNE_MOVES];
+    evalstats *pes = EVALSTATS();
+    SSE_ALIGN(float arParentInput[NUM_PRUNING_INPUTS]);
 
     GenerateMoves(&ml, anBoardIn, nDice0, nDice1, FALSE);
 
@@ -5272,15 +6146,35 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
         /* forced move */
         ml.iMoveBest = 0;
         PositionFromKey(anBoardOut, &ml.amMoves[ml.iMoveBest].key);
+        if (phashOut)
+            *phashOut = ml.amMoves[ml.iMoveBest].hash;
         return;
     }
 
     if (ml.cMoves <= PRUNE_MOVES) {
         ScoreMoves(&ml, pci, pec, 0);
         PositionFromKey(anBoardOut, &ml.amMoves[ml.iMoveBest].key);
+        if (phashOut)
+            *phashOut = ml.amMoves[ml.iMoveBest].hash;
         return;
     }
 
+    if (nnStates) {
+        /* start incremental evaluations; the moves for all 21 rolls
+         * from anBoardIn share their accumulators, which start from
+         * anBoardIn itself with the opponent on roll */
+        TanBoard anBoardParent;
+
+        memcpy(anBoardParent, anBoardIn, sizeof(TanBoard));
+        SwapSides(anBoardParent);
+        baseInputs((ConstTanBoard) anBoardParent, arParentInput);
+
+        PositionKey(anBoardIn, &nnStates[0].keyParent);
+        nnStates[1].keyParent = nnStates[2].keyParent = nnStates[0].keyParent;
+        nnStates[0].arParentInput = nnStates[1].arParentInput = nnStates[2].arParentInput = arParentInput;
+        nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_INCREMENTAL;
+    }
+
     pci->fMove = !pci->fMove;
 
     for (i = 0; i < ml.cMoves; i++) {
@@ -5291,7 +6185,7 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
         uint32_t l;
         /* declared volatile to avoid wrong compiler optimization
          * on some gcc systems. Remove with great care. */
-        move *const volatile pm = &ml.amMoves[i];
+        movecand *const volatile pm = &ml.amMoves[i];
 
         PositionFromKeySwapped(anBoardOut, &pm->key);
 
@@ -5303,20 +6197,21 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
         } else if (pc != evalClass)
             break;
 
-        CopyKey(pm->key, ec.key);
+        ec.hash = pm->hash;
         ec.nEvalContext = 0;
+        ec.nPlies = 0;
+        pes->cPruneLookup++;
         if ((l = CacheLookup(&cpEval, &ec, arOutput, NULL)) != CACHEHIT) {
             baseInputs((ConstTanBoard) anBoardOut, arInput);
             {
                 neuralnet *nets[] = { &nnpRace, &nnpCrashed, &nnpContact };
                 neuralnet *n = nets[pc - CLASS_RACE];
+                NNState *pnState = nnStates ? nnStates + (pc - CLASS_RACE) : NULL;
+                pes->acNetEval[STATS_NET_CLASS(pc, TRUE)]++;
 #if USE_SIMD_INSTRUCTIONS
-                (void) nnStates;        /* silence compiler warning */
-                NeuralNetEvaluateSSE(n, arInput, arOutput, NULL);
+                NeuralNetEvaluateSSE(n, arInput, arOutput, pnState);
 #else
-                if (nnStates)
-                    nnStates[pc - CLASS_RACE].state = (i == 0) ? NNSTATE_INCREMENTAL : NNSTATE_DONE;
-                NeuralNetEvaluate(n, arInput, arOutput, nnStates);
+                NeuralNetEvaluate(n, arInput, arOutput, pnState);
 #endif
                 if (pc == CLASS_RACE)
                     /* special evaluation of backgammons
@@ -5328,7 +6223,8 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
             memcpy(ec.ar, arOutput, sizeof(float) * NUM_OUTPUTS);
             ec.ar[5] = 0.f;
             CacheAdd(&cpEval, &ec, l);
-        }
+        } else
+            pes->cPruneHit++;
         pm->rScore = UtilityME(arOutput, pci);
         if (i < PRUNE_MOVES) {
             bmovesi[i] = i;
@@ -5351,16 +6247,29 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
 
     pci->fMove = !pci->fMove;
 
+    if (nnStates) {
+        /* reset to none */
+        nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_NONE;
+        memset(&nnStates[0].keyParent, 0, sizeof(positionkey));
+        nnStates[1].keyParent = nnStates[2].keyParent = nnStates[0].keyParent;
+        nnStates[0].arParentInput = nnStates[1].arParentInput = nnStates[2].arParentInput = NULL;
+    }
+
     if (i == ml.cMoves)
         ScoreMovesPruned(&ml, pci, pec, bmovesi);
     else
         ScoreMoves(&ml, pci, pec, 0);
 
     PositionFromKey(anBoardOut, &ml.amMoves[ml.iMoveBest].key);
+    if (phashOut)
+        *phashOut = ml.amMoves[ml.iMoveBest].hash;
 }
 
+/* hash is PositionHash(anBoard); the hashes of the positions after each
+ * roll come from the move generator rather than being recomputed */
+
 static int
-EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[],
+EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, uint64_t hash, float arOutput[],
                      cubeinfo * const pci, const evalcontext * pec, unsigned int nPlies, positionclass pc)
 {
     int i, n0, n1;
@@ -5372,6 +6281,7 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
         /* internal node; recurse */
 
         TanBoard anBoardNew;
+        uint64_t hashNew;
         /* int anMove[ 8 ]; */
         cubeinfo ciOpp;
         int const usePrune = pec->fUsePrune && pec->rNoise == 0.0f && pci->bgv == VARIATION_STANDARD;
@@ -5390,27 +6300,30 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
                     anBoardNew[1][i] = anBoard[1][i];
                 }
 
-                if (fInterrupt) {
+                if (EvalInterrupted()) {
                     errno = EINTR;
                     return -1;
                 }
 
                 if (usePrune) {
-                    FindBestMoveInEval(nnStates, n0, n1, anBoard, anBoardNew, pci, pec);
+                    hashNew = hash;     /* unless a move is made */
+                    FindBestMoveInEval(nnStates, n0, n1, anBoard, anBoardNew, &hashNew, pci, pec);
                 } else {
 
                     FindBestMovePlied(NULL, n0, n1, anBoardNew, pci, pec, 0, defaultFilters);
+                    hashNew = PositionHash((ConstTanBoard) anBoardNew);
                 }
 
                 SwapSides(anBoardNew);
+                hashNew = HashSwapSides(hashNew);
 
                 SetCubeInfo(&ciOpp, pci->nCube, pci->fCubeOwner, !pci->fMove,
                             pci->nMatchTo, pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
 
                 /* Evaluate at 0-ply */
-                if (EvaluatePositionCache(nnStates, (ConstTanBoard) anBoardNew, arVariationOutput,
-                                          &ciOpp, pec, nPlies - 1,
-                                          ClassifyPosition((ConstTanBoard) anBoardNew, ciOpp.bgv)))
+                if (EvaluatePositionCacheHash(nnStates, (ConstTanBoard) anBoardNew, hashNew, arVariationOutput,
+                                              &ciOpp, pec, nPlies - 1,
+                                              ClassifyPosition((ConstTanBoard) anBoardNew, ciOpp.bgv)))
                     return -1;
 
                 for (i = 0; i < NUM_OUTPUTS; i++)
@@ -5454,8 +6367,8 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
 
 
 static int
-EvaluatePositionCache(NNState * nnStates, const TanBoard anBoard, float arOutput[],
-                      cubeinfo * const pci, const evalcontext * pecx, int nPlies, positionclass pc)
+EvaluatePositionCacheHash(NNState * nnStates, const TanBoard anBoard, uint64_t hash, float arOutput[],
+                          cubeinfo * const pci, const evalcontext * pecx, int nPlies, positionclass pc)
 {
     evalcache ec;
     uint32_t l;
@@ -5463,25 +6376,35 @@ EvaluatePositionCache(NNState * nnStates, const TanBoard anBoard, float arOutput
      * time-consuming operations at a relatively steady rate, so is a
      * good choice for a callback function. */
     if (!cCache || pecx->rNoise != 0.0f) {      /* non-deterministic noisy evaluations; cannot cache */
-        return EvaluatePositionFull(nnStates, anBoard, arOutput, pci, pecx, nPlies, pc);
+        return EvaluatePositionFull(nnStates, anBoard, hash, arOutput, pci, pecx, nPlies, pc);
     }
 
-    PositionKey(anBoard, &ec.key);
+    ec.hash = hash;
 
     ec.nEvalContext = EvalKey(pecx, nPlies, pci, FALSE);
+    ec.nPlies = nPlies;
     if ((l = CacheLookup(&cEval, &ec, arOutput, NULL)) == CACHEHIT) {
+        StatsCacheLookup(nPlies, pc, TRUE);
         return 0;
     }
+    StatsCacheLookup(nPlies, pc, FALSE);
 
-    if (EvaluatePositionFull(nnStates, anBoard, arOutput, pci, pecx, nPlies, pc))
+    if (EvaluatePositionFull(nnStates, anBoard, hash, arOutput, pci, pecx, nPlies, pc))
         return -1;
 
     memcpy(ec.ar, arOutput, sizeof(float) * NUM_OUTPUTS);
     ec.ar[5] = 0.f;
-    CacheAdd(&cEval, &ec, l);
+    StatsCacheAdd(CacheAdd(&cEval, &ec, l));
     return 0;
 }
 
+static int
+EvaluatePositionCache(NNState * nnStates, const TanBoard anBoard, float arOutput[],
+                      cubeinfo * const pci, const evalcontext * pecx, int nPlies, positionclass pc)
+{
+    return EvaluatePositionCacheHash(nnStates, anBoard, PositionHash(anBoard), arOutput, pci, pecx, nPlies, pc);
+}
+
 extern int
 EvaluatePosition(NNState * nnStates, const TanBoard anBoard, float arOutput[],
                  cubeinfo * const pci, const evalcontext * pec)
@@ -5493,8 +6416,8 @@ EvaluatePosition(NNState * nnStates, const TanBoard anBoard, float arOutput[],
 }
 
 
-extern int
-ScoreMove(NNState * nnStates, move * pm, const cubeinfo * pci, const evalcontext * pec, int nPlies)
+static int
+ScoreMoveCand(NNState * nnStates, movecand * pm, const cubeinfo * pci, const evalcontext * pec, int nPlies)
 {
     TanBoard anBoardTemp;
     SSE_ALIGN(float arEval[NUM_ROLLOUT_OUTPUTS]);
@@ -5518,9 +6441,9 @@ ScoreMove(NNState * nnStates, move * pm, const cubeinfo * pci, const evalcontext
     memcpy(pm->arEvalMove, arEval, NUM_ROLLOUT_OUTPUTS * sizeof(float));
 
     /* Save evaluation setup */
-    pm->esMove.et = EVAL_EVAL;
-    pm->esMove.ec = *pec;
-    pm->esMove.ec.nPlies = nPlies;
+    pm->et = EVAL_EVAL;
+    pm->ec = *pec;
+    pm->ec.nPlies = nPlies;
 
     /* Score for move:
      * rScore is the primary score (cubeful/cubeless)
@@ -5531,23 +6454,352 @@ ScoreMove(NNState * nnStates, move * pm, const cubeinfo * pci, const evalcontext
     return 0;
 }
 
+extern int
+ScoreMove(NNState * nnStates, move * pm, const cubeinfo * pci, const evalcontext * pec, int nPlies)
+{
+    movecand mc;
+
+    CopyKey(pm->key, mc.key);
+    if (ScoreMoveCand(nnStates, &mc, pci, pec, nPlies) < 0)
+        return -1;
+
+    memcpy(pm->arEvalMove, mc.arEvalMove, sizeof(pm->arEvalMove));
+    pm->esMove.et = mc.et;
+    pm->esMove.ec = mc.ec;
+    pm->rScore = mc.rScore;
+    pm->rScore2 = mc.rScore2;
+
+    return 0;
+}
+
+/* Fill the evaluation cache with the 0-ply neural net evaluations of
+ * the given moves (all moves if ai is NULL), so that the ScoreMoveCand()
+ * calls that follow find them there.  Moves are grouped by position
+ * class and each group is evaluated with NeuralNetEvaluateBatch(),
+ * which streams the weights once per batch rather than once per move. */
+
+static void
+FlushMovesBatch(positionclass pc, unsigned int c, TanBoard aanBoard[], evalcache aec[], const uint32_t al[],
+                const bgvariation bgv)
+{
+    float aarOutput[NN_BATCH_SIZE][NUM_OUTPUTS];
+    unsigned int i;
+
+    if (EvalNeuralNetBatch(pc, c, aanBoard, aarOutput, bgv))
+        return;
+
+    for (i = 0; i < c; i++) {
+        SanityCheck((ConstTanBoard) aanBoard[i], aarOutput[i]);
+        memcpy(aec[i].ar, aarOutput[i], sizeof(float) * NUM_OUTPUTS);
+        aec[i].ar[5] = 0.f;
+        StatsCacheAdd(CacheAdd(&cEval, &aec[i], al[i]));
+    }
+}
+
+static void
+BatchEvaluateMoves(const movecandlist * pml, const unsigned int *ai, unsigned int cMoves,
+                   const cubeinfo * pci, const evalcontext * pec)
+{
+    TanBoard aaanBoard[CLASS_CONTACT - CLASS_RACE + 1][NN_BATCH_SIZE];
+    evalcache aaec[CLASS_CONTACT - CLASS_RACE + 1][NN_BATCH_SIZE];
+    uint32_t aal[CLASS_CONTACT - CLASS_RACE + 1][NN_BATCH_SIZE];
+    unsigned int ac[CLASS_CONTACT - CLASS_RACE + 1] = { 0, 0, 0 };
+    SSE_ALIGN(float arOutput[NUM_OUTPUTS]);
+    float rCubeful;
+    int nEvalContext, nCubefulContext;
+    cubeinfo ci;
+    unsigned int i;
+    int j;
+
+    if (!cCache || pec->rNoise != 0.0f)
+        /* ScoreMoveCand() will not use the cache */
+        return;
+
+    /* ScoreMoveCand() evaluates the positions from the opponent's point of
+     * view; cubeful evaluations reach the net through EvaluatePosition
+     * with the basic context */
+    memcpy(&ci, pci, sizeof(ci));
+    ci.fMove = !ci.fMove;
+    nEvalContext = EvalKey(pec->fCubeful ? &ecBasic : pec, 0, &ci, FALSE);
+    nCubefulContext = EvalKey(pec, 0, &ci, TRUE);
+
+    for (i = 0; i < cMoves; i++) {
+        const movecand *pm = &pml->amMoves[ai ? ai[i] : i];
+        TanBoard anBoard;
+        positionclass pc;
+        evalcache *pe;
+        uint32_t l;
+
+        PositionFromKeySwapped(anBoard, &pm->key);
+
+        pc = ClassifyPosition((ConstTanBoard) anBoard, ci.bgv);
+        if (pc < CLASS_RACE)
+            continue;
+
+        j = pc - CLASS_RACE;
+        pe = &aaec[j][ac[j]];
+
+        pe->hash = HashSwapSides(pm->hash);
+        pe->nPlies = 0;
+
+        if (pec->fCubeful) {
+            pe->nEvalContext = nCubefulContext;
+            if (CacheLookup(&cEval, pe, arOutput, &rCubeful) == CACHEHIT) {
+                StatsCacheLookup(0, pc, TRUE);
+                continue;
+            }
+            StatsCacheLookup(0, pc, FALSE);
+        }
+
+        pe->nEvalContext = nEvalContext;
+        if ((l = CacheLookup(&cEval, pe, arOutput, NULL)) == CACHEHIT) {
+            StatsCacheLookup(0, pc, TRUE);
+            continue;
+        }
+        StatsCacheLookup(0, pc, FALSE);
+
+        aal[j][ac[j]] = l;
+        memcpy(aaanBoard[j][ac[j]], anBoard, sizeof(TanBoard));
+
+        if (++ac[j] == NN_BATCH_SIZE) {
+            FlushMovesBatch(pc, ac[j], aaanBoard[j], aaec[j], aal[j], ci.bgv);
+            ac[j] = 0;
+        }
+    }
+
+    for (j = 0; j <= CLASS_CONTACT - CLASS_RACE; j++)
+        if (ac[j])
+            FlushMovesBatch(CLASS_RACE + j, ac[j], aaanBoard[j], aaec[j], aal[j], ci.bgv);
+}
+
+/* Rolls by decreasing probability */
+static const int aanProgressiveRoll[21][2] = {
+    {2, 1}, {3, 1}, {3, 2}, {4, 1}, {4, 2}, {4, 3}, {5, 1}, {5, 2}, {5, 3}, {5, 4},
+    {6, 1}, {6, 2}, {6, 3}, {6, 4}, {6, 5},
+    {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}, {6, 6}
+};
+
+/* index of the roll in the n0, n1 loops of EvaluatePositionFull() */
+#define ROLL_INDEX(n0, n1) ((n0) * ((n0) - 1) / 2 + (n1) - 1)
+
+/* The cubeless nPlies evaluation of pm, as EvaluatePositionFull() does
+ * it, but looking at the rolls by decreasing probability.  The equity
+ * of the mover after each roll is left in arRoll[] and, if arLeader is
+ * given, compared with the leader's after the same roll.  No roll can
+ * be worth more than winning a backgammon, so once the differences seen
+ * so far, and those the rolls still to come would give at that equity,
+ * add up to less than nothing the move cannot catch the leader: it is
+ * given up and 1 returned.  Otherwise
+ * the evaluation summed in the usual order is added to the cache, where
+ * ScoreMoveCand() will find it for cubeless contexts. */
+
+static int
+ScoreMoveProgressive(NNState * nnStates, const movecand * pm, const cubeinfo * pci, const evalcontext * pec,
+                     int nPlies, const float arLeader[21], float arRoll[21])
+{
+    TanBoard anBoard, anBoardNew;
+    uint64_t hash, hashNew;
+    float aarOutput[21][NUM_OUTPUTS];
+    float arWinBackgammon[NUM_OUTPUTS] = { 1.0f, 1.0f, 1.0f, 0.0f, 0.0f };
+    float rSum = 0.0f, rBest, rRest = 0.0f;
+    cubeinfo ci, ciOpp;
+    evalcache ec;
+    uint32_t l;
+    int i, k, n0, n1, w;
+    evalstats *pes = EVALSTATS();
+    int const usePrune = pec->fUsePrune && pec->rNoise == 0.0f && pci->bgv == VARIATION_STANDARD;
+
+    /* the position after the move, and the cubeinfo, as ScoreMoveCand()
+     * passes them to the evaluation */
+    PositionFromKeySwapped(anBoard, &pm->key);
+    hash = HashSwapSides(pm->hash);
+    memcpy(&ci, pci, sizeof(ci));
+    ci.fMove = !ci.fMove;
+
+    SetCubeInfo(&ciOpp, ci.nCube, ci.fCubeOwner, !ci.fMove,
+                ci.nMatchTo, ci.anScore, ci.fCrawford, ci.fJacoby, ci.fBeavers, ci.bgv);
+
+    /* what the rolls still to come could at most gain on the leader */
+    rBest = UtilityME(arWinBackgammon, &ciOpp);
+    if (arLeader)
+        for (k = 0; k < 21; k++)
+            rRest += (aanProgressiveRoll[k][0] == aanProgressiveRoll[k][1] ? 1 : 2) * (rBest - arLeader[k]);
+
+    for (k = 0; k < 21; k++) {
+        float *ar;
+
+        n0 = aanProgressiveRoll[k][0];
+        n1 = aanProgressiveRoll[k][1];
+        ar = aarOutput[ROLL_INDEX(n0, n1)];
+
+        if (EvalInterrupted()) {
+            errno = EINTR;
+            return -1;
+        }
+
+        memcpy(anBoardNew, anBoard, sizeof(TanBoard));
+
+        if (usePrune) {
+            hashNew = hash;
+            FindBestMoveInEval(nnStates, n0, n1, (ConstTanBoard) anBoard, anBoardNew, &hashNew, &ci, pec);
+        } else {
+            FindBestMovePlied(NULL, n0, n1, anBoardNew, &ci, pec, 0, defaultFilters);
+            hashNew = PositionHash((ConstTanBoard) anBoardNew);
+        }
+
+        SwapSides(anBoardNew);
+        hashNew = HashSwapSides(hashNew);
+
+        if (EvaluatePositionCacheHash(nnStates, (ConstTanBoard) anBoardNew, hashNew, ar, &ciOpp, pec, nPlies - 1,
+                                      ClassifyPosition((ConstTanBoard) anBoardNew, ciOpp.bgv)))
+            return -1;
+
+        w = (n0 == n1) ? 1 : 2;
+        arRoll[k] = UtilityME(ar, &ciOpp);
+        if (!arLeader)
+            continue;
+
+        rSum += w * (arRoll[k] - arLeader[k]);
+        rRest -= w * (rBest - arLeader[k]);
+
+        if (k < 20 && rSum + rRest < 0.0f) {
+            pes->acProgressiveSkipped[STATS_PLY(nPlies)] += 20 - k;
+            return 1;
+        }
+    }
+
+    if (!cCache || pec->rNoise != 0.0f || pec->fCubeful)
+        return 0;
+
+    /* sum, normalize and flop as EvaluatePositionFull() does */
+    for (i = 0; i < NUM_OUTPUTS; i++)
+        ec.ar[i] = 0.0f;
+    for (n0 = 1; n0 <= 6; n0++)
+        for (n1 = 1; n1 <= n0; n1++) {
+            w = (n0 == n1) ? 1 : 2;
+            for (i = 0; i < NUM_OUTPUTS; i++)
+                ec.ar[i] += w * aarOutput[ROLL_INDEX(n0, n1)][i];
+        }
+    for (i = 0; i < NUM_OUTPUTS; i++)
+        ec.ar[i] /= 36;
+
+    ec.ar[OUTPUT_WIN] = 1.0f - ec.ar[OUTPUT_WIN];
+    ec.ar[5] = ec.ar[OUTPUT_WINGAMMON];
+    ec.ar[OUTPUT_WINGAMMON] = ec.ar[OUTPUT_LOSEGAMMON];
+    ec.ar[OUTPUT_LOSEGAMMON] = ec.ar[5];
+    ec.ar[5] = ec.ar[OUTPUT_WINBACKGAMMON];
+    ec.ar[OUTPUT_WINBACKGAMMON] = ec.ar[OUTPUT_LOSEBACKGAMMON];
+    ec.ar[OUTPUT_LOSEBACKGAMMON] = ec.ar[5];
+    ec.ar[5] = 0.f;
+
+    ec.hash = hash;
+    ec.nEvalContext = EvalKey(pec, nPlies, &ci, FALSE);
+    ec.nPlies = nPlies;
+    if ((l = CacheLookup(&cEval, &ec, aarOutput[0], NULL)) != CACHEHIT)
+        StatsCacheAdd(CacheAdd(&cEval, &ec, l));
+
+    return 0;
+}
+
+/* ScoreMoves() at the last ply with fEvalProgressive.  The moves are
+ * taken in the order of the previous ply, so the first one is the
+ * likely leader; moves given up by ScoreMoveProgressive() keep their
+ * previous evaluation and are moved after the others, out of
+ * pml->cMoves, as if a move filter had dropped them. */
+
+static int
+ScoreMovesProgressive(movecandlist * pml, const cubeinfo * pci, const evalcontext * pec, int nPlies)
+{
+    unsigned int i, cKept = 0, cDropped = 0;
+    float arLeader[21], arRoll[21];
+    float rLeader = -99999.9f;
+    int fLeader = FALSE;
+    movecand *amDropped = (movecand *) malloc(pml->cMoves * sizeof(movecand));
+    NNState *nnStates = MT_Get_nnState();
+    evalstats *pes = EVALSTATS();
+    int r = 0;
+
+    if (!amDropped)
+        return -1;
+
+    pml->rBestScore = -99999.9f;
+
+    for (i = 0; i < pml->cMoves; i++) {
+        movecand *pm = pml->amMoves + i;
+        TanBoard anBoard;
+        int fProgressive;
+
+        PositionFromKeySwapped(anBoard, &pm->key);
+
+        if ((fProgressive = ClassifyPosition((ConstTanBoard) anBoard, pci->bgv) > CLASS_PERFECT)) {
+            pes->acProgressiveMoves[STATS_PLY(nPlies)]++;
+
+            if ((r = ScoreMoveProgressive(nnStates, pm, pci, pec, nPlies, fLeader ? arLeader : NULL, arRoll)) < 0)
+                break;
+
+            if (r) {
+                pes->acProgressiveDropped[STATS_PLY(nPlies)]++;
+                memcpy(amDropped + cDropped++, pm, sizeof(movecand));
+                continue;
+            }
+        }
+
+        if ((r = ScoreMoveCand(nnStates, pm, pci, pec, nPlies)) < 0)
+            break;
+
+        /* the leader is the best move scored progressively so far */
+        if (fProgressive && pm->rScore > rLeader) {
+            rLeader = pm->rScore;
+            memcpy(arLeader, arRoll, sizeof(arLeader));
+            fLeader = TRUE;
+        }
+
+        if (cKept != i)
+            memcpy(pml->amMoves + cKept, pm, sizeof(movecand));
+
+        pm = pml->amMoves + cKept;
+        if ((pm->rScore > pml->rBestScore) || ((pm->rScore == pml->rBestScore)
+                                               && (pm->rScore2 > pml->amMoves[pml->iMoveBest].rScore2))) {
+            pml->iMoveBest = cKept;
+            pml->rBestScore = pm->rScore;
+        }
+        cKept++;
+    }
+
+    if (r >= 0) {
+        memcpy(pml->amMoves + cKept, amDropped, cDropped * sizeof(movecand));
+        pml->cMoves = cKept;
+    }
+
+    free(amDropped);
+
+    return r < 0 ? -1 : 0;
+}
+
 static int
-ScoreMoves(movelist * pml, const cubeinfo * pci, const evalcontext * pec, int nPlies)
+ScoreMoves(movecandlist * pml, const cubeinfo * pci, const evalcontext * pec, int nPlies)
 {
     unsigned int i;
     int r = 0;                  /* return value */
     NNState *nnStates = MT_Get_nnState();
 
+    /* only the last ply of a search, where nothing but the leader
+     * matters; earlier plies must rank the moves for the move filter */
+    if (fEvalProgressive && nPlies > 0 && nPlies == (int) pec->nPlies && pml->cMoves > 1 && pec->rNoise == 0.0f)
+        return ScoreMovesProgressive(pml, pci, pec, nPlies);
+
     pml->rBestScore = -99999.9f;
 
     if (nPlies == 0) {
+        BatchEvaluateMoves(pml, NULL, pml->cMoves, pci, pec);
+
         /* start incremental evaluations */
         nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_INCREMENTAL;
     }
 
 
     for (i = 0; i < pml->cMoves; i++) {
-        if (ScoreMove(nnStates, pml->amMoves + i, pci, pec, nPlies) < 0) {
+        if (ScoreMoveCand(nnStates, pml->amMoves + i, pci, pec, nPlies) < 0) {
             r = -1;
             break;
         }
@@ -5570,7 +6822,7 @@ ScoreMoves(movelist * pml, const cubeinfo * pci, const evalcontext * pec, int nP
 }
 
 static int
-ScoreMovesPruned(movelist * pml, const cubeinfo * pci, const evalcontext * pec, unsigned int *bmovesi)
+ScoreMovesPruned(movecandlist * pml, const cubeinfo * pci, const evalcontext * pec, unsigned int *bmovesi)
 {
     unsigned int i, j;
     int r = 0;                  /* return value */
@@ -5578,6 +6830,8 @@ ScoreMovesPruned(movelist * pml, const cubeinfo * pci, const evalcontext * pec,
 
     pml->rBestScore = -99999.9f;
 
+    BatchEvaluateMoves(pml, bmovesi, PRUNE_MOVES, pci, pec);
+
     /* start incremental evaluations */
     nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_INCREMENTAL;
 
@@ -5585,7 +6839,7 @@ ScoreMovesPruned(movelist * pml, const cubeinfo * pci, const evalcontext * pec,
 
         i = bmovesi[j];
 
-        if (ScoreMove(nnStates, pml->amMoves + i, pci, pec, 0) < 0) {
+        if (ScoreMoveCand(nnStates, pml->amMoves + i, pci, pec, 0) < 0) {
             r = -1;
             break;
         }
@@ -5613,8 +6867,10 @@ FindBestMovePlied(int anMove[8], int nDice0, int nDice1,
 {
 
     evalcontext ec;
-    movelist ml;
+    movecandlist ml;
     unsigned int i;
+    double t;
+    int r;
 
     memcpy(&ec, pec, sizeof(evalcontext));
     ec.nPlies = nPlies;
@@ -5623,7 +6879,10 @@ FindBestMovePlied(int anMove[8], int nDice0, int nDice1,
         for (i = 0; i < 8; ++i)
             anMove[i] = -1;
 
-    if (FindnSaveBestMoves(&ml, nDice0, nDice1, (ConstTanBoard) anBoard, NULL, 0.0f, pci, &ec, aamf) < 0)
+    t = EvalStatsPhaseStart(STATS_PHASE_CHEQUER);
+    r = SearchBestMoves(&ml, nDice0, nDice1, (ConstTanBoard) anBoard, NULL, 0.0f, pci, &ec, aamf);
+    EvalStatsPhaseEnd(STATS_PHASE_CHEQUER, t);
+    if (r < 0)
         return -1;
 
     if (anMove) {
@@ -5651,10 +6910,18 @@ FindBestMove(int anMove[8], int nDice0, int nDice1,
     return FindBestMovePlied(anMove, nDice0, nDice1, anBoard, pci, pec ? pec : &ecBasic, pec ? pec->nPlies : 0, aamf);
 }
 
-extern int
-FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoard, positionkey * keyMove, const
-                   float rThr, const cubeinfo * pci, const evalcontext * pec,
-                   movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES])
+static int
+CompareMoveCands(const movecand * pm0, const movecand * pm1)
+{
+
+    /*high score first */
+    return (pm1->rScore > pm0->rScore || (pm1->rScore == pm0->rScore && pm1->rScore2 > pm0->rScore2)) ? 1 : -1;
+}
+
+static int
+SearchBestMoves(movecandlist * pml, int nDice0, int nDice1, const TanBoard anBoard, positionkey * keyMove, const
+                float rThr, const cubeinfo * pci, const evalcontext * pec,
+                movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES])
 {
 
     /* Find best moves. 
@@ -5662,10 +6929,12 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
 
     unsigned int i;
     unsigned int nMoves, iPly;
-    move *pm;
+    movecand *pm;
     movefilter *mFilters;
     unsigned int nMaxPly = 0;
     int cOldMoves;
+    int fOuter = EVALSTATS()->anPhaseDepth[STATS_PHASE_CHEQUER] == 1;
+    double t = 0.0;
 
     /* Find all moves -- note that pml contains internal pointers to static
      * data, so we can't call GenerateMoves again (or anything that calls
@@ -5680,8 +6949,8 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
     }
 
     /* Save moves */
-    pm = (move *) malloc(pml->cMoves * sizeof(move));
-    memcpy(pm, pml->amMoves, pml->cMoves * sizeof(move));
+    pm = (movecand *) malloc(pml->cMoves * sizeof(movecand));
+    memcpy(pm, pml->amMoves, pml->cMoves * sizeof(movecand));
     pml->amMoves = pm;
     nMoves = pml->cMoves;
 
@@ -5698,11 +6967,20 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
             continue;
         }
 
+        if (fOuter)
+            t = get_time();
+
         if (ScoreMoves(pml, pci, pec, iPly) < 0) {
+            free(pm);
+            pml->cMoves = 0;
+            pml->amMoves = NULL;
             return -1;
         }
 
-        qsort(pml->amMoves, pml->cMoves, sizeof(move), (cfunc) CompareMoves);
+        if (fOuter)
+            StatsSearchPly(iPly, pml->cMoves, t);
+
+        qsort(pml->amMoves, pml->cMoves, sizeof(movecand), (cfunc) CompareMoveCands);
         pml->iMoveBest = 0;
 
         k = pml->cMoves;
@@ -5730,6 +7008,9 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
 
     /* evaluate moves on top ply */
 
+    if (fOuter)
+        t = get_time();
+
     if (ScoreMoves(pml, pci, pec, pec->nPlies) < 0) {
         free(pm);
         pml->cMoves = 0;
@@ -5737,10 +7018,13 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
         return -1;
     }
 
+    if (fOuter)
+        StatsSearchPly(pec->nPlies, pml->cMoves, t);
+
     nMaxPly = pec->nPlies;
 
     /* Resort the moves, in case the new evaluation reordered them. */
-    qsort(pml->amMoves, pml->cMoves, sizeof(move), (cfunc) CompareMoves);
+    qsort(pml->amMoves, pml->cMoves, sizeof(movecand), (cfunc) CompareMoveCands);
     pml->iMoveBest = 0;
 
     /* set the proper size of the movelist */
@@ -5761,8 +7045,8 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
 
                 /* ensure top move is evaluted at deepest ply */
 
-                if (pml->amMoves[i].esMove.ec.nPlies < nMaxPly) {
-                    ScoreMove(NULL, pml->amMoves + i, pci, pec, nMaxPly);
+                if (pml->amMoves[i].ec.nPlies < nMaxPly) {
+                    ScoreMoveCand(NULL, pml->amMoves + i, pci, pec, nMaxPly);
                     fResort = TRUE;
                 }
 
@@ -5770,8 +7054,8 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
 
                     /* this is en error/blunder: re-analyse at top-ply */
 
-                    ScoreMove(NULL, pml->amMoves, pci, pec, pec->nPlies);
-                    ScoreMove(NULL, pml->amMoves + i, pci, pec, pec->nPlies);
+                    ScoreMoveCand(NULL, pml->amMoves, pci, pec, pec->nPlies);
+                    ScoreMoveCand(NULL, pml->amMoves + i, pci, pec, pec->nPlies);
                     cOldMoves = 1;      /* only one move scored at deepest ply */
                     fResort = TRUE;
 
@@ -5780,19 +7064,19 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
                 /* move it up to the other moves evaluated on nMaxPly */
 
                 if (fResort && pec->nPlies) {
-                    move m;
+                    movecand m;
                     int j;
 
                     memcpy(&m, pml->amMoves + i, sizeof m);
 
                     for (j = i - 1; j >= cOldMoves; --j)
-                        memcpy(pml->amMoves + j + 1, pml->amMoves + j, sizeof(move));
+                        memcpy(pml->amMoves + j + 1, pml->amMoves + j, sizeof(movecand));
 
                     memcpy(pml->amMoves + cOldMoves, &m, sizeof(m));
 
                     /* reorder moves evaluated on nMaxPly */
 
-                    qsort(pml->amMoves, cOldMoves + 1, sizeof(move), (cfunc) CompareMoves);
+                    qsort(pml->amMoves, cOldMoves + 1, sizeof(movecand), (cfunc) CompareMoveCands);
 
                 }
                 break;
@@ -5803,6 +7087,59 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
 
 }
 
+/* The move handed back for the candidate pmc; it has not been rolled
+ * out, and its evaluation setup is that of the evaluation of pmc */
+
+static void
+MoveFromCand(move * pm, const movecand * pmc)
+{
+    memset(pm, 0, sizeof(move));
+
+    memcpy(pm->anMove, pmc->anMove, sizeof(pm->anMove));
+    CopyKey(pmc->key, pm->key);
+    pm->hash = pmc->hash;
+    pm->cMoves = pmc->cMoves;
+    pm->cPips = pmc->cPips;
+    pm->rScore = pmc->rScore;
+    pm->rScore2 = pmc->rScore2;
+    memcpy(pm->arEvalMove, pmc->arEvalMove, sizeof(pm->arEvalMove));
+    pm->esMove.et = pmc->et;
+    pm->esMove.ec = pmc->ec;
+    pm->cmark = CMARK_NONE;
+}
+
+/* SearchBestMoves(), timed as a chequer play phase, with the candidates
+ * made into full moves */
+
+extern int
+FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoard, positionkey * keyMove, const
+                   float rThr, const cubeinfo * pci, const evalcontext * pec,
+                   movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES])
+{
+    movecandlist ml;
+    unsigned int i;
+    double t = EvalStatsPhaseStart(STATS_PHASE_CHEQUER);
+    int r = SearchBestMoves(&ml, nDice0, nDice1, anBoard, keyMove, rThr, pci, pec, aamf);
+
+    EvalStatsPhaseEnd(STATS_PHASE_CHEQUER, t);
+
+    pml->cMoves = ml.cMoves;
+    pml->cMaxMoves = ml.cMaxMoves;
+    pml->cMaxPips = ml.cMaxPips;
+    pml->iMoveBest = ml.iMoveBest;
+    pml->rBestScore = ml.rBestScore;
+    pml->amMoves = NULL;
+
+    if (ml.amMoves) {
+        pml->amMoves = (move *) malloc(ml.cMoves * sizeof(move));
+        for (i = 0; i < ml.cMoves; i++)
+            MoveFromCand(pml->amMoves + i, ml.amMoves + i);
+        free(ml.amMoves);
+    }
+
+    return r;
+}
+
 extern int
 GeneralCubeDecisionE(float aarOutput[2][NUM_ROLLOUT_OUTPUTS],
                      const TanBoard anBoard,
@@ -5812,7 +7149,8 @@ GeneralCubeDecisionE(float aarOutput[2][NUM_ROLLOUT_OUTPUTS],
     SSE_ALIGN(float arOutput[NUM_OUTPUTS]);
     cubeinfo aciCubePos[2];
     float arCubeful[2];
-    int i, j;
+    int i, j, r;
+    double t;
 
 
     /* Setup cube for "no double" and "double, take" */
@@ -5822,7 +7160,10 @@ GeneralCubeDecisionE(float aarOutput[2][NUM_ROLLOUT_OUTPUTS],
     aciCubePos[1].fCubeOwner = !aciCubePos[1].fMove;
     aciCubePos[1].nCube *= 2;
 
-    if (EvaluatePositionCubeful3(NULL, anBoard, arOutput, arCubeful, aciCubePos, 2, pci, pec, pec->nPlies, TRUE))
+    t = EvalStatsPhaseStart(STATS_PHASE_CUBE);
+    r = EvaluatePositionCubeful3(NULL, anBoard, arOutput, arCubeful, aciCubePos, 2, pci, pec, pec->nPlies, TRUE);
+    EvalStatsPhaseEnd(STATS_PHASE_CUBE, t);
+    if (r)
         return -1;
 
 
@@ -5955,13 +7296,13 @@ EvaluatePositionCubeful4(NNState * nnStates, const TanBoard anBoard,
                     anBoardNew[1][i] = anBoard[1][i];
                 }
 
-                if (fInterrupt) {
+                if (EvalInterrupted()) {
                     errno = EINTR;
                     return -1;
                 }
 
                 if (usePrune) {
-                    FindBestMoveInEval(nnStates, n0, n1, anBoard, anBoardNew, pciMove, pec);
+                    FindBestMoveInEval(nnStates, n0, n1, anBoard, anBoardNew, NULL, pciMove, pec);
                 } else {
 
                     FindBestMovePlied(NULL, n0, n1, anBoardNew, pciMove, pec, 0, defaultFilters);
@@ -6225,7 +7566,8 @@ EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard,
                                         aciCubePos, cci, pciMove, pec, nPlies, fTop);
     }
 
-    PositionKey(anBoard, &ec.key);
+    ec.hash = PositionHash(anBoard);
+    ec.nPlies = nPlies;
 
     /* check cache for existence for earlier calculation */
 
@@ -6242,6 +7584,7 @@ EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard,
         if (CacheLookup(&cEval, &ec, arOutput, arCubeful + ici) != CACHEHIT) {
             fAll = FALSE;
         }
+        StatsCacheLookup(nPlies, STATS_CLASS_CUBEFUL, fAll);
     }
 
     /* get equities */
@@ -6265,7 +7608,7 @@ EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard,
                 ec.ar[5] = arCubeful[ici];      /* Cubeful equity stored in slot 5 */
                 ec.nEvalContext = EvalKey(pec, nPlies, &aciCubePos[ici], TRUE);
 
-                CacheAdd(&cEval, &ec, GetHashKey(cEval.hashMask, &ec));
+                StatsCacheAdd(CacheAdd(&cEval, &ec, GetHashKey(cEval.hashMask, &ec)));
 
             }
         }
@@ -267,6 +267,7 @@ typedef enum {
 typedef struct {
     int anMove[8];
     positionkey key;
+    uint64_t hash;              /* PositionHash() of key */
     unsigned int cMoves, cPips;
     /* scores for this move */
     float rScore, rScore2;
@@ -277,7 +278,27 @@ typedef struct {
     CMark cmark;
 } move;
 
+/* The part of a move that generating, scoring and sorting candidates
+ * touches, an eighth of the size of a move.  Searches work on these;
+ * only the moves a search hands back in a movelist are made into full
+ * moves. */
+typedef struct {
+    int anMove[8];
+    positionkey key;
+    uint64_t hash;              /* PositionHash() of key */
+    unsigned int cMoves, cPips;
+    float rScore, rScore2;
+    float arEvalMove[NUM_ROLLOUT_OUTPUTS];
+    /* what esMove.et and esMove.ec of the move will be */
+    evaltype et;
+    evalcontext ec;
+} movecand;
+
 extern int fInterrupt;
+/* get_time() at which plied evaluations stop, or 0 for no limit; the flag
+ * records that they stopped because of it */
+extern double rEvalDeadline;
+extern int fEvalDeadlinePassed;
 extern cubeinfo ciCubeless;
 extern const char *aszEvalType[(int) EVAL_ROLLOUT + 1];
 
@@ -295,6 +316,28 @@ typedef struct {
     move *amMoves;
 } movelist;
 
+typedef struct {
+    unsigned int cMoves;        /* and current move when building list */
+    unsigned int cMaxMoves, cMaxPips;
+    int iMoveBest;
+    float rBestScore;
+    movecand *amMoves;
+} movecandlist;
+
+/* Open addressing set of the keys of the moves in the movelist being
+ * generated, owned like its amMoves buffer by the thread (see
+ * MT_Get_MoveHash()), so that SaveMoves() finds duplicates in constant
+ * time.  aiMove[] holds an index into amMoves; a slot is in use only if
+ * its generation is the current one, so emptying the set is a single
+ * increment. */
+#define MOVE_HASH_SIZE 8192     /* a power of two, over twice MAX_INCOMPLETE_MOVES */
+
+typedef struct {
+    unsigned int nGeneration;
+    unsigned int anGeneration[MOVE_HASH_SIZE];
+    unsigned short aiMove[MOVE_HASH_SIZE];
+} movehash;
+
 /* cube efficiencies */
 
 extern float rOSCubeX;
@@ -330,6 +373,17 @@ typedef int (*classevalfunc) (const TanBoard anBoard, float arOutput[], const bg
 
 extern classevalfunc acef[N_CLASSES];
 
+extern int EvalNeuralNetBatch(positionclass pc, unsigned int cBoards, TanBoard aanBoard[],
+                              float aarOutput[][NUM_OUTPUTS], const bgvariation bgv);
+extern int EvalQuantize(int f);
+extern float QuantizedEvalDeviation(unsigned int *pcPositions);
+extern unsigned int MoveGenMismatches(unsigned int cPositions);
+extern unsigned int EscapeMaskMismatches(unsigned int cBoards, double *prInputs, double *prNet);
+
+extern int fEvalQuantized;
+extern int fMoveGenBits;
+extern int fEvalProgressive;
+
 /* Evaluation cache size is 2^SIZE entries */
 #define CACHE_SIZE_DEFAULT 19
 #define CACHE_SIZE_GUIMAX 23
@@ -403,8 +457,63 @@ extern evalCache cEval;
 extern evalCache cpEval;
 extern unsigned int cCache;
 
+/* Counters kept by the evaluator for `show statistics engine'.  Each
+ * thread has its own set, EvalStatsSum() adds them up. */
+
+#define STATS_PLIES 8           /* deeper searches count as STATS_PLIES - 1 */
+/* the cubeful cache is probed before the position is classified, so its
+ * lookups are counted in a column of their own */
+#define STATS_CLASS_CUBEFUL N_CLASSES
+#define STATS_CLASSES (N_CLASSES + 1)
+
+typedef enum {
+    STATS_NET_CONTACT,
+    STATS_NET_CRASHED,
+    STATS_NET_RACE,
+    STATS_NET_PRUNE_CONTACT,
+    STATS_NET_PRUNE_CRASHED,
+    STATS_NET_PRUNE_RACE,
+    STATS_NETS
+} statsnet;
+
+typedef enum {
+    STATS_PHASE_CHEQUER,        /* FindnSaveBestMoves() */
+    STATS_PHASE_CUBE,           /* GeneralCubeDecisionE() */
+    STATS_PHASE_ROLLOUT,        /* RolloutGeneral() */
+    STATS_PHASES
+} statsphase;
+
+typedef struct _evalstats {
+    uint64_t aacCacheLookup[STATS_PLIES][STATS_CLASSES];
+    uint64_t aacCacheHit[STATS_PLIES][STATS_CLASSES];
+    uint64_t acCacheEvict[STATS_PLIES]; /* by depth of the entry dropped */
+    uint64_t cPruneLookup;
+    uint64_t cPruneHit;
+    uint64_t acNetEval[STATS_NETS];
+    uint64_t cMoveGen;
+    uint64_t cMovesGenerated;
+    /* moves scored and milliseconds taken at each depth of the
+     * outermost FindnSaveBestMoves() */
+    uint64_t acSearchMoves[STATS_PLIES];
+    double arSearchTime[STATS_PLIES];
+    /* calls and milliseconds of the outermost call of each phase */
+    uint64_t acPhase[STATS_PHASES];
+    double arPhaseTime[STATS_PHASES];
+    unsigned int anPhaseDepth[STATS_PHASES];
+    /* moves scored by ScoreMovesProgressive(), those dropped, and the
+     * rolls they were spared, by the depth of the scoring */
+    uint64_t acProgressiveMoves[STATS_PLIES];
+    uint64_t acProgressiveDropped[STATS_PLIES];
+    uint64_t acProgressiveSkipped[STATS_PLIES];
+} evalstats;
+
+extern void EvalStatsSum(evalstats * pes);
+extern void EvalStatsReset(void);
+extern double EvalStatsPhaseStart(statsphase sp);
+extern void EvalStatsPhaseEnd(statsphase sp, double t);
+
 extern int
- GenerateMoves(movelist * pml, const TanBoard anBoard, int n0, int n1, int fPartial);
+ GenerateMoves(movecandlist * pml, const TanBoard anBoard, int n0, int n1, int fPartial);
 
 extern int ApplySubMove(TanBoard anBoard, const int iSrc, const int nRoll, const int fCheckLegal);
 
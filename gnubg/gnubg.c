@@ -187,6 +187,7 @@ int fConfirmSave = TRUE;
 int nAutoSaveTime = 15;
 int fAutoSaveRollout = FALSE;
 int fAutoSaveAnalysis = FALSE;
+int fAutoSaveCheckpoint = FALSE;
 int fAutoSaveConfirmDelete = TRUE;
 
 /* FIXME: This is at best useless, at worst misleading, as a global flag.
@@ -480,9 +481,9 @@ exportsetup exsExport = {
 
 
 player ap[2] = {
-    {"gnubg", PLAYER_GNU, EVALSETUP_WORLDCLASS, EVALSETUP_WORLDCLASS, MOVEFILTER_NORMAL, 0, NULL}
+    {"gnubg", PLAYER_GNU, EVALSETUP_WORLDCLASS, EVALSETUP_WORLDCLASS, MOVEFILTER_NORMAL, 0, NULL, 0, 0}
     ,
-    {"user", PLAYER_HUMAN, EVALSETUP_WORLDCLASS, EVALSETUP_WORLDCLASS, MOVEFILTER_NORMAL, 0, NULL}
+    {"user", PLAYER_HUMAN, EVALSETUP_WORLDCLASS, EVALSETUP_WORLDCLASS, MOVEFILTER_NORMAL, 0, NULL, 0, 0}
 };
 
 char default_names[2][31] = { "gnubg", "user" };
@@ -582,7 +583,9 @@ static char const *aszBuildInfo[] = {
     N_("Multiple threads supported."),
 #endif
 #if USE_SIMD_INSTRUCTIONS
-#if USE_SSE2
+#if USE_WASM_SIMD
+    N_("WebAssembly SIMD supported."),
+#elif USE_SSE2
     N_("SSE/SSE2 supported."),
 #elif USE_AVX
     N_("AVX supported."),
@@ -2578,7 +2581,14 @@ CommandRollout(char *sz)
     void *p;
 
     if (CountTokens(sz) > 0) {
-        outputerrf("%s", _("The rollout command takes no arguments and only rollouts the current position"));
+        char *pch = NextToken(&sz);
+
+        if (!StrNCaseCmp(pch, "resume", strlen(pch))) {
+            CommandRolloutResume(sz);
+            return;
+        }
+        outputerrf("%s", _("The rollout command takes no arguments and only rollouts the current position "
+                           "(or `rollout resume <file>' goes on with a checkpoint)"));
         return;
     }
     if (ms.gs != GAME_PLAYING) {
@@ -3173,6 +3183,8 @@ SavePlayerSettings(FILE * pf)
             SaveEvalSetupSettings(pf, szTemp, &ap[i].esChequer);
             sprintf(szTemp, "set player %d cubedecision", i);
             SaveEvalSetupSettings(pf, szTemp, &ap[i].esCube);
+            fprintf(pf, "set player %d chequerplay timed %u\n", i, ap[i].nChequerTime);
+            fprintf(pf, "set player %d cubedecision timed %u\n", i, ap[i].nCubeTime);
             sprintf(szTemp, "set player %d movefilter", i);
             SaveMoveFilterSettings(pf, szTemp, ap[i].aamf);
             break;
@@ -3216,6 +3228,9 @@ static void
 SaveEvaluationSettings(FILE * pf)
 {
     fprintf(pf, "set eval sameasanalysis %s\n", fEvalSameAsAnalysis ? "on" : "off");
+    fprintf(pf, "set eval quantized %s\n", fEvalQuantized ? "on" : "off");
+    fprintf(pf, "set eval bitboardmoves %s\n", fMoveGenBits ? "on" : "off");
+    fprintf(pf, "set eval progressive %s\n", fEvalProgressive ? "on" : "off");
     SaveEvalSetupSettings(pf, "set evaluation chequerplay", &esEvalChequer);
     SaveEvalSetupSettings(pf, "set evaluation cubedecision", &esEvalCube);
     SaveMoveFilterSettings(pf, "set evaluation movefilter", aamfEval);
@@ -3224,6 +3239,7 @@ SaveEvaluationSettings(FILE * pf)
     fprintf(pf, "set invert matchequitytable %s\n", fInvertMET ? "on" : "off");
 #if USE_MULTITHREAD
     fprintf(pf, "set threads %u\n", MT_GetNumThreads());
+    fprintf(pf, "set rolloutmerge %u\n", nRolloutMergeInterval);
 #endif
 }
 
@@ -3234,6 +3250,9 @@ SaveAutoSaveSettings(FILE * pf)
     fprintf(pf, "set autosave rollout %s\n", fAutoSaveRollout ? "on" : "off");
     fprintf(pf, "set autosave analysis %s\n", fAutoSaveAnalysis ? "on" : "off");
     fprintf(pf, "set autosave confirm %s\n", fAutoSaveConfirmDelete ? "on" : "off");
+    fprintf(pf, "set autosave checkpoint %s\n", fAutoSaveCheckpoint ? "on" : "off");
+    if (szRolloutCheckpoint)
+        fprintf(pf, "set autosave checkpointfile \"%s\"\n", szRolloutCheckpoint);
 }
 
 static void
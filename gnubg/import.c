@@ -718,7 +718,7 @@ ParseMatMove(char *sz, int iPlayer, int *warned)
 
             /* roll but no move found; if there are legal moves assume
              * a resignation */
-            movelist ml;
+            movecandlist ml;
             int anDice[2];
             anDice[0] = pmr->anDice[0];
             anDice[1] = pmr->anDice[1];
@@ -2681,7 +2681,7 @@ ImportTMGGame(FILE * pf, int i, int nLength, int n0, int n1,
                 pmr->fPlayer = fPlayer;
 
                 if (!strncmp(pch, "0/0", 3)) {  /* See if fan is legal (i.e. no moves available) - otherwise skip */
-                    movelist ml;
+                    movecandlist ml;
                     if (GenerateMoves(&ml, msBoard(), pmr->anDice[0], pmr->anDice[1], FALSE) == 0) {
                         /* fans */
                         AddMoveRecord(pmr);
@@ -28,7 +28,6 @@
 #endif
 
 #include "cache.h"
-#include "positionid.h"
 
 #if USE_MULTITHREAD
 #include "multithread.h"
@@ -37,20 +36,20 @@
   && (defined (__i386) || defined (__x86_64))
 
 #define cache_lock(pc, k) \
-    while (__sync_lock_test_and_set(&(pc->entries[k].lock), 1)) \
-         while (pc->entries[k].lock) \
+    while (__sync_lock_test_and_set(&(pc->alock[(k) & (CACHE_LOCKS - 1)]), 1)) \
+         while (pc->alock[(k) & (CACHE_LOCKS - 1)]) \
             __asm volatile ("pause" ::: "memory")
 
 #define cache_unlock(pc, k) \
-    __sync_lock_release(&(pc->entries[k].lock));
+    __sync_lock_release(&(pc->alock[(k) & (CACHE_LOCKS - 1)]));
 
 #else
 
 #define cache_lock(pc, k) \
-if (MT_SafeIncCheck(&(pc->entries[k].lock))) \
-	WaitForLock(&(pc->entries[k].lock))
+if (MT_SafeIncCheck(&(pc->alock[(k) & (CACHE_LOCKS - 1)]))) \
+	WaitForLock(&(pc->alock[(k) & (CACHE_LOCKS - 1)]))
 
-#define cache_unlock(pc, k) MT_SafeDec(&(pc->entries[k].lock))
+#define cache_unlock(pc, k) MT_SafeDec(&(pc->alock[(k) & (CACHE_LOCKS - 1)]))
 
 static void
 WaitForLock(volatile int *lock)
@@ -64,16 +63,13 @@ WaitForLock(volatile int *lock)
 
 #endif                          /* USE_MULTITHREAD */
 
+#ifndef CACHELINE_SIZE
+#define CACHELINE_SIZE 64
+#endif
 
 int
 CacheCreate(evalCache * pc, unsigned int s)
 {
-#if CACHE_STATS
-    pc->cLookup = 0;
-    pc->cHit = 0;
-    pc->nAdds = 0;
-#endif
-
     if (s > 1u << 31)
         return -1;
 
@@ -83,92 +79,71 @@ CacheCreate(evalCache * pc, unsigned int s)
         s &= (s - 1);
 
     pc->size = (s < pc->size) ? 2 * s : s;
-    pc->hashMask = (pc->size >> 1) - 1;
-
-    pc->entries = (cacheNode *) malloc((pc->size / 2) * sizeof(*pc->entries));
-    if (pc->entries == 0)
+    /* a cache of fewer entries than a bucket still gets one bucket */
+    pc->hashMask = pc->size > CACHE_WAYS ? (pc->size / CACHE_WAYS) - 1 : 0;
+    pc->nGeneration = 0;
+    pc->cAddsGeneration = 0;
+
+    /* buckets must not straddle cache lines */
+    pc->pAlloc = malloc((pc->hashMask + 1) * sizeof(*pc->entries) + CACHELINE_SIZE - 1);
+    if (pc->pAlloc == 0)
         return -1;
+    pc->entries = (cacheNode *) (((uintptr_t) pc->pAlloc + CACHELINE_SIZE - 1) & ~(uintptr_t) (CACHELINE_SIZE - 1));
 
     CacheFlush(pc);
     return 0;
 }
 
-/* MurmurHash3  https://code.google.com/p/smhasher/wiki/MurmurHash */
-
 extern uint32_t
 GetHashKey(uint32_t hashMask, const cacheNodeDetail * e)
 {
-    uint32_t hash = (uint32_t) e->nEvalContext;
-    int i;
-
-    hash *= 0xcc9e2d51;
-    hash = (hash << 15) | (hash >> (32 - 15));
-    hash *= 0x1b873593;
+    return (uint32_t) GetHash(e) & hashMask;
+}
 
-    hash = (hash << 13) | (hash >> (32 - 13));
-    hash = hash * 5 + 0xe6546b64;
+/* Look for the entry of the given hash in bucket l.  A hit in entry
+ * 1 is promoted to entry 0. */
 
-    for (i = 0; i < 7; i++) {
-        uint32_t k = e->key.data[i];
+static inline int
+CacheFind(evalCache * pc, uint32_t l, uint64_t hash, float *arOut, float *arCubeful)
+{
+    cacheEntry *const ae = pc->entries[l].ae;
 
-        k *= 0xcc9e2d51;
-        k = (k << 15) | (k >> (32 - 15));
-        k *= 0x1b873593;
+    if (!CacheEntryMatches(&ae[0], hash) || !ae[0].info) {      /* Not in first entry */
+        if (!CacheEntryMatches(&ae[1], hash) || !ae[1].info)    /* Cache miss */
+            return 0;
+        else {                  /* Found in second entry, promote "hot" entry */
+            cacheEntry tmp = ae[0];
 
-        hash ^= k;
-        hash = (hash << 13) | (hash >> (32 - 13));
-        hash = hash * 5 + 0xe6546b64;
+            ae[0] = ae[1];
+            ae[1] = tmp;
+        }
     }
 
-    /* Real MurmurHash3 has a "hash ^= len" here,
-     * but for us len is constant. Skip it */
-
-    hash ^= hash >> 16;
-    hash *= 0x85ebca6b;
-    hash ^= hash >> 13;
-    hash *= 0xc2b2ae35;
-    hash ^= hash >> 16;
+    /* Cache hit */
+    memcpy(arOut, ae[0].ar, sizeof(float) * 5 /*NUM_OUTPUTS */ );
+    if (arCubeful)
+        *arCubeful = ae[0].ar[5];       /* Cubeful equity stored in slot 5 */
 
-    return (hash & hashMask);
+    return 1;
 }
 
-
 uint32_t
 CacheLookupWithLocking(evalCache * pc, const cacheNodeDetail * e, float *arOut, float *arCubeful)
 {
-    uint32_t const l = GetHashKey(pc->hashMask, e);
+    uint64_t const hash = GetHash(e);
+    uint32_t const l = (uint32_t) hash & pc->hashMask;
+    int fHit;
 
-#if CACHE_STATS
-    ++pc->cLookup;
-#endif
 #if USE_MULTITHREAD
     cache_lock(pc, l);
 #endif
-    if (!EqualKeys(pc->entries[l].nd_primary.key, e->key) || pc->entries[l].nd_primary.nEvalContext != e->nEvalContext) {       /* Not in primary slot */
-        if (!EqualKeys(pc->entries[l].nd_secondary.key, e->key) || pc->entries[l].nd_secondary.nEvalContext != e->nEvalContext) {       /* Cache miss */
-#if USE_MULTITHREAD
-            cache_unlock(pc, l);
-#endif
-            return l;
-        } else {                /* Found in second slot, promote "hot" entry */
-            cacheNodeDetail tmp = pc->entries[l].nd_primary;
-
-            pc->entries[l].nd_primary = pc->entries[l].nd_secondary;
-            pc->entries[l].nd_secondary = tmp;
-        }
-    }
-    /* Cache hit */
-    memcpy(arOut, pc->entries[l].nd_primary.ar, sizeof(float) * 5 /*NUM_OUTPUTS */ );
-    if (arCubeful)
-        *arCubeful = pc->entries[l].nd_primary.ar[5];   /* Cubeful equity stored in slot 5 */
-
+    fHit = CacheFind(pc, l, hash, arOut, arCubeful);
 #if USE_MULTITHREAD
     cache_unlock(pc, l);
 #endif
 
-#if CACHE_STATS
-    ++pc->cHit;
-#endif
+    if (!fHit)
+        return l;
 
     return CACHEHIT;
 }
@@ -176,70 +151,142 @@ CacheLookupWithLocking(evalCache * pc, const cacheNodeDetail * e, float *arOut,
 uint32_t
 CacheLookupNoLocking(evalCache * pc, const cacheNodeDetail * e, float *arOut, float *arCubeful)
 {
-    uint32_t const l = GetHashKey(pc->hashMask, e);
-
-#if CACHE_STATS
-    ++pc->cLookup;
-#endif
-    if (!EqualKeys(pc->entries[l].nd_primary.key, e->key) || pc->entries[l].nd_primary.nEvalContext != e->nEvalContext) {       /* Not in primary slot */
-        if (!EqualKeys(pc->entries[l].nd_secondary.key, e->key) || pc->entries[l].nd_secondary.nEvalContext != e->nEvalContext) {       /* Cache miss */
-            return l;
-        } else {                /* Found in second slot, promote "hot" entry */
-            cacheNodeDetail tmp = pc->entries[l].nd_primary;
-
-            pc->entries[l].nd_primary = pc->entries[l].nd_secondary;
-            pc->entries[l].nd_secondary = tmp;
-        }
-    }
-
-    /* Cache hit */
-    memcpy(arOut, pc->entries[l].nd_primary.ar, sizeof(float) * 5 /*NUM_OUTPUTS */ );
-    if (arCubeful)
-        *arCubeful = pc->entries[l].nd_primary.ar[5];   /* Cubeful equity stored in slot 5 */
+    uint64_t const hash = GetHash(e);
+    uint32_t const l = (uint32_t) hash & pc->hashMask;
 
-#if CACHE_STATS
-    ++pc->cHit;
-#endif
+    if (!CacheFind(pc, l, hash, arOut, arCubeful))
+        return l;
 
     return CACHEHIT;
 }
 
-void
+uint32_t
 CacheAddWithLocking(evalCache * pc, const cacheNodeDetail * e, uint32_t l)
 {
+    uint64_t const hash = GetHash(e);
+    uint32_t infoDropped;
+
 #if USE_MULTITHREAD
     cache_lock(pc, l);
 #endif
 
-    pc->entries[l].nd_secondary = pc->entries[l].nd_primary;
-    pc->entries[l].nd_primary = *e;
+    infoDropped = CacheStore(pc, e, l, hash);
 
 #if USE_MULTITHREAD
     cache_unlock(pc, l);
 #endif
 
-#if CACHE_STATS
-    ++pc->nAdds;
-#endif
+    CacheNextAdd(pc);
+    return infoDropped;
+}
+
+#if USE_MULTITHREAD
+/* The adds are counted across all the stripes, so without the bucket
+ * locks; size is a power of 2 and the count may wrap */
+void
+CacheNextAdd(evalCache * pc)
+{
+    if (((unsigned int) MT_SafeIncValue(&pc->cAddsGeneration) & (pc->size - 1)) == 0)
+        MT_SafeInc(&pc->nGeneration);
 }
+#endif
 
 void
 CacheDestroy(const evalCache * pc)
 {
-    free(pc->entries);
+    free(pc->pAlloc);
 }
 
 void
 CacheFlush(const evalCache * pc)
 {
-    unsigned int k;
-    for (k = 0; k < pc->size / 2; ++k) {
-        pc->entries[k].nd_primary.key.data[0] = (unsigned int) -1;
-        pc->entries[k].nd_secondary.key.data[0] = (unsigned int) -1;
+    memset(pc->entries, 0, (pc->hashMask + 1) * sizeof(*pc->entries));
 #if USE_MULTITHREAD
-        pc->entries[k].lock = 0;
+    memset((void *) pc->alock, 0, sizeof(pc->alock));
 #endif
+}
+
+static int
+CompareRecords(const void *p0, const void *p1)
+{
+    uint16_t const info0 = ((const cacheRecord *) p0)->e.info;
+    uint16_t const info1 = ((const cacheRecord *) p1)->e.info;
+
+    /* deepest first, then most recent */
+    if ((info0 & 0x0f) != (info1 & 0x0f))
+        return (info0 & 0x0f) > (info1 & 0x0f) ? -1 : 1;
+    if (info0 != info1)
+        return info0 < info1 ? -1 : 1;
+    return 0;
+}
+
+/* Copy the used entries to ar, which has room for CACHE_WAYS per bucket,
+ * deepest and most recent first.  Returns how many there were. */
+
+unsigned int
+CacheSnapshot(const evalCache * pc, cacheRecord * ar)
+{
+    unsigned int c = 0;
+    uint32_t i;
+    int j;
+
+    for (i = 0; i <= pc->hashMask; i++)
+        for (j = 0; j < CACHE_WAYS; j++) {
+            const cacheEntry *pce = &pc->entries[i].ae[j];
+
+            if (!pce->info)
+                continue;
+
+            ar[c].iBucket = i;
+            ar[c].e = *pce;
+            ar[c].e.info = (uint16_t) (((((uint32_t) pc->nGeneration - (pce->info >> 4)) & 0x0fff) << 4) | (pce->info & 0x0f));
+            c++;
+        }
+
+    qsort(ar, c, sizeof(*ar), CompareRecords);
+
+    return c;
+}
+
+/* Put back c entries from CacheSnapshot() of a cache with at least as
+ * many buckets as pc.  An entry goes to a free way of its bucket, or
+ * replaces one that is worth less.  Returns how many were kept. */
+
+unsigned int
+CacheRestore(evalCache * pc, const cacheRecord * ar, unsigned int c)
+{
+    unsigned int i, cKept = 0;
+
+    for (i = 0; i < c; i++) {
+        cacheEntry *const ae = pc->entries[ar[i].iBucket & pc->hashMask].ae;
+        cacheEntry e = ar[i].e;
+        int j;
+
+        if (!(e.info & 0x0f))
+            continue;
+
+        e.info = (uint16_t) (((((uint32_t) pc->nGeneration - (e.info >> 4)) & 0x0fff) << 4) | (e.info & 0x0f));
+
+        if (ae[0].info && ae[0].check == e.check && ae[0].checkLow == e.checkLow)
+            continue;
+        if (ae[1].info && ae[1].check == e.check && ae[1].checkLow == e.checkLow)
+            continue;
+
+        if (!ae[0].info)
+            j = 0;
+        else if (!ae[1].info)
+            j = 1;
+        else
+            j = CacheEntryWorth(pc, &ae[0]) < CacheEntryWorth(pc, &ae[1]) ? 0 : 1;
+
+        if (ae[j].info && CacheEntryWorth(pc, &ae[j]) >= CacheEntryWorth(pc, &e))
+            continue;
+
+        ae[j] = e;
+        cKept++;
     }
+
+    return cKept;
 }
 
 int
@@ -254,28 +301,19 @@ CacheResize(evalCache * pc, unsigned int cNew)
     return (int) pc->size;
 }
 
-void
-CacheStats(const evalCache * pc, unsigned int *pcLookup, unsigned int *pcHit, unsigned int *pcUsed)
-{
-#if CACHE_STATS
-    if (pcLookup)
-        *pcLookup = pc->cLookup;
-
-    if (pcHit)
-        *pcHit = pc->cHit;
+/* The number of entries in use */
 
-    if (pcUsed)
-        *pcUsed = pc->nAdds;
-#else
-    (void) pc;                  /* suppress unused parameter compiler warning */
-
-    if (pcLookup)
-        *pcLookup = 0;
+unsigned int
+CacheUsed(const evalCache * pc)
+{
+    unsigned int c = 0;
+    uint32_t i;
+    int j;
 
-    if (pcHit)
-        *pcHit = 0;
+    for (i = 0; i <= pc->hashMask; i++)
+        for (j = 0; j < CACHE_WAYS; j++)
+            if (pc->entries[i].ae[j].info)
+                c++;
 
-    if (pcUsed)
-        *pcUsed = 0;
-#endif
+    return c;
 }
@@ -29,40 +29,76 @@
 #include <stdint.h>
 #else
 typedef unsigned int uint32_t;
+typedef unsigned long long uint64_t;
 #endif
 
 #include "gnubg-types.h"
 
-/* Set to calculate simple cache stats */
-#define CACHE_STATS 0
-
+/* An evaluation to look up or add: the PositionHash() of the position
+ * and the evaluation context, and when adding, the outputs and the
+ * depth of the search that produced them */
 typedef struct _cacheNodeDetail {
-    positionkey key;
+    uint64_t hash;
     int nEvalContext;
+    int nPlies;
     float ar[6];
 } cacheNodeDetail;
 
+/* What the cache keeps of a cacheNodeDetail.  Position and context
+ * are replaced by bits 16-63 of their combined hash.  With the bucket
+ * index, which is bits 0-15 and up, a hit is checked against the whole
+ * hash in caches of 2^16 buckets or more.  info is 0 for an empty entry,
+ * otherwise the depth of search plus one in bits 0-3 and the generation
+ * it was added in above. */
+typedef struct _cacheEntry {
+    uint32_t check;             /* bits 32-63 of the hash */
+    uint16_t checkLow;          /* bits 16-31 */
+    uint16_t info;
+    float ar[6];
+} cacheEntry;
+
+/* A bucket is exactly one 64 byte cache line.  A hit in entry 1 is
+ * moved to entry 0, which is looked at first.  Four entries in two lines instead were measured to
+ * save a quarter of a percent of the evaluations at 2- and 3-ply. */
+#define CACHE_WAYS 2
+
 typedef struct _cacheNode {
-    cacheNodeDetail nd_primary;
-    cacheNodeDetail nd_secondary;
-#if USE_MULTITHREAD
-    volatile int lock;
-#endif
+    cacheEntry ae[CACHE_WAYS];
 } cacheNode;
 
+/* An entry as taken out by CacheSnapshot(): the bucket it was found in,
+ * and in info its age in generations in place of the generation it was
+ * added in */
+typedef struct _cacheRecord {
+    uint32_t iBucket;
+    cacheEntry e;
+} cacheRecord;
+
 /* name used in eval.c */
 typedef cacheNodeDetail evalcache;
 
+/* Buckets are locked in stripes, so that the lock does not need room
+ * in the bucket */
+#define CACHE_LOCKS 1024
+
 typedef struct _cache {
     cacheNode *entries;
+    void *pAlloc;               /* entries before alignment */
 
     unsigned int size;
     uint32_t hashMask;
 
-#if CACHE_STATS
-    unsigned int nAdds;
-    unsigned int cLookup;
-    unsigned int cHit;
+    /* incremented every size adds, to age out deep evaluations; only
+     * the low 12 bits are used */
+#if USE_MULTITHREAD
+    /* shared by all the stripes, so changed with MT_SafeInc() */
+    volatile int nGeneration;
+    volatile int cAddsGeneration;
+
+    volatile int alock[CACHE_LOCKS];
+#else
+    uint32_t nGeneration;
+    unsigned int cAddsGeneration;
 #endif
 } evalCache;
 
@@ -75,20 +111,110 @@ int CacheResize(evalCache * pc, unsigned int cNew);
 unsigned int CacheLookupWithLocking(evalCache * pc, const cacheNodeDetail * e, float *arOut, float *arCubeful);
 unsigned int CacheLookupNoLocking(evalCache * pc, const cacheNodeDetail * e, float *arOut, float *arCubeful);
 
-void CacheAddWithLocking(evalCache * pc, const cacheNodeDetail * e, uint32_t l);
+/* The position hash combined with the context: the low bits select the
+ * bucket, the upper 48 are kept in the entry to recognise it.  The
+ * context goes through the MurmurHash3 64 bit finaliser so that it
+ * changes both. */
+static inline uint64_t
+GetHash(const cacheNodeDetail * e)
+{
+    uint64_t hash = (uint32_t) e->nEvalContext;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return e->hash ^ hash;
+}
+
+static inline int
+CacheEntryMatches(const cacheEntry * pce, uint64_t hash)
+{
+    return pce->check == (uint32_t) (hash >> 32) && pce->checkLow == (uint16_t) (hash >> 16);
+}
+
+/* An entry that has seen fewer generations go by than its depth of
+ * search is worth more than a shallower one */
+static inline int
+CacheEntryWorth(const evalCache * pc, const cacheEntry * pce)
+{
+    return (int) (pce->info & 0x0f) - (int) (((uint32_t) pc->nGeneration - (pce->info >> 4)) & 0x0fff);
+}
+
+/* Put e, whose GetHash() is hash, in bucket l.  An older copy of e, as
+ * when two threads miss on the same position, is overwritten; else e
+ * goes to a free entry or replaces the one worth less.  If both are
+ * worth more than e, as two recent 2-ply evaluations are against a
+ * 0-ply leaf, e is not kept.  Returns the info of the entry that was
+ * dropped from the bucket, or 0 if none was. */
+static inline uint32_t
+CacheStore(evalCache * pc, const cacheNodeDetail * e, const uint32_t l, const uint64_t hash)
+{
+    cacheEntry *const ae = pc->entries[l].ae;
+    unsigned int nPlies = e->nPlies < 14 ? (unsigned int) e->nPlies : 14;
+    uint32_t infoDropped = 0;
+    int j;
+
+    if (ae[0].info && CacheEntryMatches(&ae[0], hash))
+        j = 0;
+    else if (ae[1].info && CacheEntryMatches(&ae[1], hash))
+        j = 1;
+    else if (!ae[0].info)
+        j = 0;
+    else if (!ae[1].info)
+        j = 1;
+    else {
+        j = CacheEntryWorth(pc, &ae[0]) < CacheEntryWorth(pc, &ae[1]) ? 0 : 1;
+        /* e is new, so its worth is its depth */
+        if (CacheEntryWorth(pc, &ae[j]) > (int) nPlies + 1)
+            return 0;
+        infoDropped = ae[j].info;
+    }
+
+    ae[j].check = (uint32_t) (hash >> 32);
+    ae[j].checkLow = (uint16_t) (hash >> 16);
+    ae[j].info = (uint16_t) (((uint32_t) pc->nGeneration << 4) | (nPlies + 1));
+    ae[j].ar[0] = e->ar[0];
+    ae[j].ar[1] = e->ar[1];
+    ae[j].ar[2] = e->ar[2];
+    ae[j].ar[3] = e->ar[3];
+    ae[j].ar[4] = e->ar[4];
+    ae[j].ar[5] = e->ar[5];
+
+    return infoDropped;
+}
+
+/* Count an add towards the next generation */
+#if USE_MULTITHREAD
+void CacheNextAdd(evalCache * pc);
+#else
 static inline void
-CacheAddNoLocking(evalCache * pc, const cacheNodeDetail * e, const uint32_t l)
+CacheNextAdd(evalCache * pc)
 {
-    pc->entries[l].nd_secondary = pc->entries[l].nd_primary;
-    pc->entries[l].nd_primary = *e;
-#if CACHE_STATS
-    ++pc->nAdds;
+    if (++pc->cAddsGeneration >= pc->size) {
+        pc->cAddsGeneration = 0;
+        pc->nGeneration = (pc->nGeneration + 1) & 0x0fff;
+    }
+}
 #endif
+
+uint32_t CacheAddWithLocking(evalCache * pc, const cacheNodeDetail * e, uint32_t l);
+static inline uint32_t
+CacheAddNoLocking(evalCache * pc, const cacheNodeDetail * e, const uint32_t l)
+{
+    uint32_t infoDropped = CacheStore(pc, e, l, GetHash(e));
+
+    CacheNextAdd(pc);
+    return infoDropped;
 }
 
 void CacheFlush(const evalCache * pc);
+unsigned int CacheSnapshot(const evalCache * pc, cacheRecord * ar);
+unsigned int CacheRestore(evalCache * pc, const cacheRecord * ar, unsigned int c);
 void CacheDestroy(const evalCache * pc);
-void CacheStats(const evalCache * pc, unsigned int *pcLookup, unsigned int *pcHit, unsigned int *pcUsed);
+unsigned int CacheUsed(const evalCache * pc);
 
 uint32_t GetHashKey(uint32_t hashMask, const cacheNodeDetail * e);
 
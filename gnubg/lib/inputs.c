@@ -23,7 +23,7 @@
 #include "simd.h"
 #include "eval.h"
 
-#if USE_SIMD_INSTRUCTIONS
+#if USE_SIMD_INSTRUCTIONS && !defined(USE_WASM_SIMD)
 #if defined(USE_AVX)
 #include <immintrin.h>
 #elif defined(USE_SSE2)
@@ -31,7 +31,7 @@
 #else
 #include <xmmintrin.h>
 #endif
-#else
+#elif !USE_SIMD_INSTRUCTIONS
 typedef float float_vector[4];
 #endif /* USE_SIMD_INSTRUCTIONS */
 
@@ -105,7 +105,9 @@ SSE_ALIGN(static float_vec_aligned inpvecb[16]) = {
         /* 15 */  {
 1.0, 1.0, 1.0, 6.0}};
 
-#if USE_SIMD_INSTRUCTIONS
+/* the web build (USE_WASM_SIMD) has no x86 intrinsics and uses the
+ * plain version */
+#if USE_SIMD_INSTRUCTIONS && !defined(USE_WASM_SIMD)
 extern SIMD_AVX_STACKALIGN void
 baseInputs(const TanBoard anBoard, float arInput[])
 {
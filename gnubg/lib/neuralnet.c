@@ -29,6 +29,7 @@
 #include <string.h>
 #include <time.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "neuralnet.h"
 #include "simd.h"
@@ -41,9 +42,13 @@ NeuralNetCreate(neuralnet * pnn, unsigned int cInput, unsigned int cHidden,
     pnn->cInput = cInput;
     pnn->cHidden = cHidden;
     pnn->cOutput = cOutput;
+    pnn->cHiddenTrained = cHidden;
     pnn->rBetaHidden = rBetaHidden;
     pnn->rBetaOutput = rBetaOutput;
     pnn->nTrained = 0;
+    pnn->asHiddenWeight = NULL;
+    pnn->aiHiddenThreshold = NULL;
+    pnn->arHiddenScale = NULL;
 
     if ((pnn->arHiddenWeight = sse_malloc(cHidden * cInput * sizeof(float))) == NULL)
         return -1;
@@ -80,18 +85,59 @@ NeuralNetDestroy(neuralnet * pnn)
     pnn->arHiddenThreshold = 0;
     sse_free(pnn->arOutputThreshold);
     pnn->arOutputThreshold = 0;
+    NeuralNetQuantizeFree(pnn);
 }
 
-#if !defined(USE_SIMD_INSTRUCTIONS)
+extern int
+NNStateCreate(NNState * pnState, unsigned int cInput, unsigned int cHidden)
+{
+    unsigned int i;
+
+    memset(pnState, 0, sizeof(NNState));
+    pnState->state = NNSTATE_NONE;
+
+    for (i = 0; i < NN_ACCUMULATORS; i++) {
+        NNAccumulator *pacc = pnState->aAccumulator + i;
+
+        if ((pacc->arInput = sse_malloc(cInput * sizeof(float))) == NULL ||
+            (pacc->arHidden = sse_malloc(cHidden * sizeof(float))) == NULL) {
+            NNStateDestroy(pnState);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+extern void
+NNStateDestroy(NNState * pnState)
+{
+    unsigned int i;
+
+    for (i = 0; i < NN_ACCUMULATORS; i++) {
+        sse_free(pnState->aAccumulator[i].arInput);
+        pnState->aAccumulator[i].arInput = 0;
+        sse_free(pnState->aAccumulator[i].arHidden);
+        pnState->aAccumulator[i].arHidden = 0;
+        pnState->aAccumulator[i].pnn = NULL;
+    }
+    pnState->pAccumulator = NULL;
+}
 
 /* separate context for race, crashed, contact
  * -1: regular eval
  * 0: save base
  * 1: from base
- */
+ *
+ * Starting a context with a known parent reuses the accumulator already
+ * holding the sums of that parent and net, if any; otherwise the oldest
+ * one is overwritten with them.  Without a parent the oldest one is
+ * overwritten by the first evaluation. */
 
-static inline NNEvalType
-NNevalAction(NNState * pnState)
+static const positionkey keyUnknown;
+
+extern NNEvalType
+NNevalAction(const neuralnet * pnn, NNState * pnState)
 {
     if (!pnState)
         return NNEVAL_NONE;
@@ -104,15 +150,34 @@ NNevalAction(NNState * pnState)
         }
     case NNSTATE_INCREMENTAL:
         {
+            unsigned int i;
+            int const fParent = memcmp(&pnState->keyParent, &keyUnknown, sizeof(positionkey)) != 0;
+
             /* next call should return FROMBASE */
             pnState->state = NNSTATE_DONE;
 
+            if (fParent)
+                for (i = 0; i < NN_ACCUMULATORS; i++) {
+                    NNAccumulator *pacc = pnState->aAccumulator + i;
+
+                    if (pacc->pnn == pnn && !memcmp(&pacc->keyParent, &pnState->keyParent, sizeof(positionkey))) {
+                        pnState->pAccumulator = pacc;
+                        return NNEVAL_FROMBASE;
+                    }
+                }
+
             /* starting a new context; save base in the hope it will be useful */
-            return NNEVAL_SAVE;
+            pnState->pAccumulator = pnState->aAccumulator + pnState->iReplace;
+            pnState->iReplace = (pnState->iReplace + 1) % NN_ACCUMULATORS;
+            pnState->pAccumulator->pnn = pnn;
+            pnState->pAccumulator->keyParent = pnState->keyParent;
+            return fParent ? NNEVAL_PARENT : NNEVAL_SAVE;
         }
     case NNSTATE_DONE:
         {
             /* context hit!  use the previously computed base */
+            if (!pnState->pAccumulator || pnState->pAccumulator->pnn != pnn)
+                return NNEVAL_NONE;
             return NNEVAL_FROMBASE;
         }
     }
@@ -120,6 +185,227 @@ NNevalAction(NNState * pnState)
     return NNEVAL_NONE;         /* for the picky compiler */
 }
 
+/* Rearrange the weights as read from file into the layout described
+ * in neuralnet.h */
+
+static int
+NeuralNetPack(neuralnet * pnn)
+{
+    unsigned int const cHidden = (pnn->cHidden + NN_HIDDEN_BLOCK - 1) / NN_HIDDEN_BLOCK * NN_HIDDEN_BLOCK;
+    float *arHiddenWeight, *arOutputWeight, *arHiddenThreshold;
+    unsigned int i, j;
+
+    if ((arHiddenWeight = sse_malloc(pnn->cInput * cHidden * sizeof(float))) == NULL)
+        return -1;
+
+    if ((arOutputWeight = sse_malloc(pnn->cOutput * cHidden * sizeof(float))) == NULL) {
+        sse_free(arHiddenWeight);
+        return -1;
+    }
+
+    if ((arHiddenThreshold = sse_malloc(cHidden * sizeof(float))) == NULL) {
+        sse_free(arOutputWeight);
+        sse_free(arHiddenWeight);
+        return -1;
+    }
+
+    memset(arHiddenWeight, 0, pnn->cInput * cHidden * sizeof(float));
+    memset(arOutputWeight, 0, pnn->cOutput * cHidden * sizeof(float));
+    memset(arHiddenThreshold, 0, cHidden * sizeof(float));
+
+    for (i = 0; i < pnn->cInput; i++)
+        memcpy(arHiddenWeight + i * cHidden, pnn->arHiddenWeight + i * pnn->cHidden, pnn->cHidden * sizeof(float));
+
+    for (i = 0; i < pnn->cOutput; i++)
+        for (j = 0; j < pnn->cHidden; j++)
+            arOutputWeight[NN_OUTPUT_WEIGHT(pnn, i, j)] = pnn->arOutputWeight[i * pnn->cHidden + j];
+
+    memcpy(arHiddenThreshold, pnn->arHiddenThreshold, pnn->cHidden * sizeof(float));
+
+    sse_free(pnn->arHiddenWeight);
+    sse_free(pnn->arOutputWeight);
+    sse_free(pnn->arHiddenThreshold);
+
+    pnn->arHiddenWeight = arHiddenWeight;
+    pnn->arOutputWeight = arOutputWeight;
+    pnn->arHiddenThreshold = arHiddenThreshold;
+    pnn->cHiddenTrained = pnn->cHidden;
+    pnn->cHidden = cHidden;
+
+    return 0;
+}
+
+/* Calculate the output nodes from the squashed hidden layer in ar[] */
+
+static void
+EvaluateOutputLayer(const neuralnet * pnn, const float ar[], float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    const unsigned int cOutput = pnn->cOutput;
+    float *arSum = (float *) g_alloca(cOutput * sizeof(float));
+    const float *prWeight = pnn->arOutputWeight;
+    unsigned int i, j, k;
+
+    memcpy(arSum, pnn->arOutputThreshold, cOutput * sizeof(float));
+
+    for (j = 0; j < cHidden; j += NN_HIDDEN_BLOCK)
+        for (i = 0; i < cOutput; i++)
+            for (k = 0; k < NN_HIDDEN_BLOCK; k++)
+                arSum[i] += ar[j + k] * *prWeight++;
+
+    for (i = 0; i < cOutput; i++)
+        arOutput[i] = sigmoid(-pnn->rBetaOutput * arSum[i]);
+}
+
+/* Fixed point evaluation.
+ *
+ * NeuralNetQuantize() keeps a 16 bit copy of the input to hidden
+ * weights next to the floating point ones.  Each hidden node has its
+ * own scale, chosen so that its largest incoming weight maps to 32767;
+ * a single scale for the layer loses too much precision, as a few
+ * weights of the trained nets are several hundred times larger than
+ * the rest.
+ *
+ * Hidden nodes are accumulated in 32 bit integers: inputs of exactly 1
+ * add the weight itself, other inputs are converted to Q12 and add
+ * (weight * input) >> 12, rounded.  The output layer is less than 1%
+ * of the work and its weights are large enough that quantizing them
+ * (or the hidden activations) shifts the equities by several
+ * hundredths, so it stays in floating point. */
+
+#define Q_INPUT_SHIFT 12
+#define Q_ONE 32767
+
+static inline short
+QuantizeShort(float r)
+{
+    long l = lrintf(r);
+
+    return (short) (l > Q_ONE ? Q_ONE : l < -Q_ONE ? -Q_ONE : l);
+}
+
+extern void
+NeuralNetQuantizeFree(neuralnet * pnn)
+{
+    free(pnn->asHiddenWeight);
+    free(pnn->aiHiddenThreshold);
+    free(pnn->arHiddenScale);
+    pnn->asHiddenWeight = NULL;
+    pnn->aiHiddenThreshold = NULL;
+    pnn->arHiddenScale = NULL;
+}
+
+extern int
+NeuralNetQuantize(neuralnet * pnn)
+{
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j;
+
+    NeuralNetQuantizeFree(pnn);
+
+    pnn->asHiddenWeight = (short *) malloc(pnn->cInput * cHidden * sizeof(short));
+    pnn->aiHiddenThreshold = (int *) malloc(cHidden * sizeof(int));
+    pnn->arHiddenScale = (float *) malloc(cHidden * sizeof(float));
+
+    if (!pnn->asHiddenWeight || !pnn->aiHiddenThreshold || !pnn->arHiddenScale) {
+        NeuralNetQuantizeFree(pnn);
+        return -1;
+    }
+
+    for (j = 0; j < cHidden; j++) {
+        float rMax = 0.0f, rScale;
+
+        for (i = 0; i < pnn->cInput; i++)
+            rMax = MAX(rMax, fabsf(pnn->arHiddenWeight[i * cHidden + j]));
+
+        rScale = rMax > 0.0f ? Q_ONE / rMax : 1.0f;
+
+        for (i = 0; i < pnn->cInput; i++)
+            pnn->asHiddenWeight[i * cHidden + j] = QuantizeShort(pnn->arHiddenWeight[i * cHidden + j] * rScale);
+
+        pnn->aiHiddenThreshold[j] = (int) lrintf(pnn->arHiddenThreshold[j] * rScale);
+        /* what evaluation multiplies the sum by before squashing */
+        pnn->arHiddenScale[j] = -pnn->rBetaHidden / rScale;
+    }
+
+    return 0;
+}
+
+extern int
+NeuralNetEvaluateQuantized(const neuralnet * pnn, const float arInput[], float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    int *ai = (int *) g_alloca(cHidden * sizeof(int));
+    float *ar = (float *) g_alloca(cHidden * sizeof(float));
+    const short *psWeight;
+    unsigned int i, j;
+
+    if (!pnn->asHiddenWeight)
+        return -1;
+
+    /* Calculate activity at hidden nodes */
+    memcpy(ai, pnn->aiHiddenThreshold, cHidden * sizeof(int));
+
+    psWeight = pnn->asHiddenWeight;
+
+    for (i = 0; i < pnn->cInput; i++, psWeight += cHidden) {
+        float const ari = arInput[i];
+
+        if (ari == 0.0f)
+            continue;
+        else if (ari == 1.0f)
+            for (j = 0; j < cHidden; j++)
+                ai[j] += psWeight[j];
+        else {
+            int const n = QuantizeShort(ari * (1 << Q_INPUT_SHIFT));
+
+            for (j = 0; j < cHidden; j++)
+                ai[j] += (psWeight[j] * n + (1 << (Q_INPUT_SHIFT - 1))) >> Q_INPUT_SHIFT;
+        }
+    }
+
+    for (j = 0; j < cHidden; j++)
+        ar[j] = sigmoid_poly(pnn->arHiddenScale[j] * ai[j]);
+
+    EvaluateOutputLayer(pnn, ar, arOutput);
+
+    return 0;
+}
+
+/* The largest differences of sigmoid_poly() from the table sigmoid()
+ * and from 1 / ( 1 + expf( x ) ), at steps of 2^-16 over [-10.5, 10.5],
+ * which covers the clamp at 10 on both sides. */
+
+extern void
+NeuralNetSigmoidError(float *prMaxTable, float *prMaxExact)
+{
+    int i;
+
+    *prMaxTable = *prMaxExact = 0.0f;
+
+    for (i = -(21 << 15); i <= 21 << 15; i++) {
+        float const x = (float) i / 65536.0f;
+        float const r = sigmoid_poly(x);
+
+        if (fabsf(r - sigmoid(x)) > *prMaxTable)
+            *prMaxTable = fabsf(r - sigmoid(x));
+        if (fabsf(r - 1.0f / (1.0f + expf(x))) > *prMaxExact)
+            *prMaxExact = fabsf(r - 1.0f / (1.0f + expf(x)));
+    }
+}
+
+#if !defined(USE_SIMD_INSTRUCTIONS)
+
+/* Squash the hidden layer activities in ar[] and calculate the output nodes */
+
+static void
+EvaluateOutputs(const neuralnet * pnn, float ar[], float arOutput[])
+{
+    sigmoid_vector(ar, pnn->cHidden, -pnn->rBetaHidden);
+
+    EvaluateOutputLayer(pnn, ar, arOutput);
+}
+
 static void
 Evaluate(const neuralnet * pnn, const float arInput[], float ar[], float arOutput[], float *saveAr)
 {
@@ -153,20 +439,7 @@ Evaluate(const neuralnet * pnn, const float arInput[], float ar[], float arOutpu
     if (saveAr)
         memcpy(saveAr, ar, cHidden * sizeof(*saveAr));
 
-    for (i = 0; i < cHidden; i++)
-        ar[i] = sigmoid(-pnn->rBetaHidden * ar[i]);
-
-    /* Calculate activity at output nodes */
-    prWeight = pnn->arOutputWeight;
-
-    for (i = 0; i < pnn->cOutput; i++) {
-        float r = pnn->arOutputThreshold[i];
-
-        for (j = 0; j < cHidden; j++)
-            r += ar[j] * *prWeight++;
-
-        arOutput[i] = sigmoid(-pnn->rBetaOutput * r);
-    }
+    EvaluateOutputs(pnn, ar, arOutput);
 }
 
 static void
@@ -201,27 +474,14 @@ EvaluateFromBase(const neuralnet * pnn, const float arInputDif[], float ar[], fl
         }
     }
 
-    for (i = 0; i < pnn->cHidden; i++)
-        ar[i] = sigmoid(-pnn->rBetaHidden * ar[i]);
-
-    /* Calculate activity at output nodes */
-    prWeight = pnn->arOutputWeight;
-
-    for (i = 0; i < pnn->cOutput; i++) {
-        float r = pnn->arOutputThreshold[i];
-
-        for (j = 0; j < pnn->cHidden; j++)
-            r += ar[j] * *prWeight++;
-
-        arOutput[i] = sigmoid(-pnn->rBetaOutput * r);
-    }
+    EvaluateOutputs(pnn, ar, arOutput);
 }
 
 extern int
 NeuralNetEvaluate(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState)
 {
     float *ar = (float *) g_alloca(pnn->cHidden * sizeof(float));
-    switch (NNevalAction(pnState)) {
+    switch (NNevalAction(pnn, pnState)) {
     case NNEVAL_NONE:
         {
             Evaluate(pnn, arInput, ar, arOutput, 0);
@@ -229,23 +489,24 @@ NeuralNetEvaluate(const neuralnet * pnn, float arInput[], float arOutput[], NNSt
         }
     case NNEVAL_SAVE:
         {
-            pnState->cSavedIBase = pnn->cInput;
-            memcpy(pnState->savedIBase, arInput, pnn->cInput * sizeof(*ar));
-            Evaluate(pnn, arInput, ar, arOutput, pnState->savedBase);
+            memcpy(pnState->pAccumulator->arInput, arInput, pnn->cInput * sizeof(*ar));
+            Evaluate(pnn, arInput, ar, arOutput, pnState->pAccumulator->arHidden);
             break;
         }
+    case NNEVAL_PARENT:
+        /* the base is the parent */
+        memcpy(pnState->pAccumulator->arInput, pnState->arParentInput, pnn->cInput * sizeof(*ar));
+        Evaluate(pnn, pnState->arParentInput, ar, arOutput, pnState->pAccumulator->arHidden);
+        /* fall through */
     case NNEVAL_FROMBASE:
         {
             unsigned int i;
-            if (pnState->cSavedIBase != (int) pnn->cInput) {
-                Evaluate(pnn, arInput, ar, arOutput, 0);
-                break;
-            }
-            memcpy(ar, pnState->savedBase, pnn->cHidden * sizeof(*ar));
+
+            memcpy(ar, pnState->pAccumulator->arHidden, pnn->cHidden * sizeof(*ar));
 
             {
                 float *r = arInput;
-                float *s = pnState->savedIBase;
+                float *s = pnState->pAccumulator->arInput;
 
                 for (i = 0; i < pnn->cInput; ++i, ++r, ++s) {
                     if (*r != *s /*lint --e(777) */ ) {
@@ -261,6 +522,56 @@ NeuralNetEvaluate(const neuralnet * pnn, float arInput[], float arOutput[], NNSt
     }
     return 0;
 }
+
+/* Evaluate up to NN_BATCH_SIZE input vectors at once.  The loop over
+ * inputs is outermost, so each column of arHiddenWeight is read from
+ * memory once per batch instead of once per position.  The additions
+ * are done in the same order as in Evaluate(), so the outputs are
+ * identical to evaluating the positions one by one. */
+
+static void
+EvaluateBatch(const neuralnet * pnn, unsigned int cBoards, float *aarInput[], float ar[], float *aarOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j, k;
+    const float *prWeight;
+
+    for (k = 0; k < cBoards; k++)
+        memcpy(ar + k * cHidden, pnn->arHiddenThreshold, cHidden * sizeof(float));
+
+    prWeight = pnn->arHiddenWeight;
+
+    for (i = 0; i < pnn->cInput; i++, prWeight += cHidden) {
+        for (k = 0; k < cBoards; k++) {
+            float const ari = aarInput[k][i];
+            float *pr = ar + k * cHidden;
+
+            if (ari == 0.0f)
+                continue;
+            else if (ari == 1.0f)
+                for (j = 0; j < cHidden; j++)
+                    pr[j] += prWeight[j];
+            else
+                for (j = 0; j < cHidden; j++)
+                    pr[j] += prWeight[j] * ari;
+        }
+    }
+
+    for (k = 0; k < cBoards; k++)
+        EvaluateOutputs(pnn, ar + k * cHidden, aarOutput[k]);
+}
+
+extern int
+NeuralNetEvaluateBatch(const neuralnet * pnn, unsigned int cBoards, float *aarInput[], float *aarOutput[])
+{
+    float *ar = (float *) g_alloca(NN_BATCH_SIZE * pnn->cHidden * sizeof(float));
+    unsigned int i;
+
+    for (i = 0; i < cBoards; i += NN_BATCH_SIZE)
+        EvaluateBatch(pnn, MIN(NN_BATCH_SIZE, cBoards - i), aarInput + i, ar, aarOutput + i);
+
+    return 0;
+}
 #endif
 
 extern int
@@ -300,7 +611,7 @@ NeuralNetLoad(neuralnet * pnn, FILE * pf)
         if (fscanf(pf, "%f\n", pr++) < 1)
             return -1;
 
-    return 0;
+    return NeuralNetPack(pnn);
 }
 
 extern int
@@ -335,7 +646,7 @@ NeuralNetLoadBinary(neuralnet * pnn, FILE * pf)
     FREAD(pnn->arOutputThreshold, pnn->cOutput);
 #undef FREAD
 
-    return 0;
+    return NeuralNetPack(pnn);
 }
 
 extern int
@@ -345,16 +656,22 @@ NeuralNetSaveBinary(const neuralnet * pnn, FILE * pf)
 #define FWRITE( p, c ) \
     if( fwrite( (p), sizeof( *(p) ), (c), pf ) < (unsigned int)(c) ) return -1;
 
+    unsigned int i, j;
+
     FWRITE(&pnn->cInput, 1);
-    FWRITE(&pnn->cHidden, 1);
+    FWRITE(&pnn->cHiddenTrained, 1);
     FWRITE(&pnn->cOutput, 1);
     FWRITE(&pnn->nTrained, 1);
     FWRITE(&pnn->rBetaHidden, 1);
     FWRITE(&pnn->rBetaOutput, 1);
 
-    FWRITE(pnn->arHiddenWeight, pnn->cInput * pnn->cHidden);
-    FWRITE(pnn->arOutputWeight, pnn->cHidden * pnn->cOutput);
-    FWRITE(pnn->arHiddenThreshold, pnn->cHidden);
+    /* back to the file layout, without the padding */
+    for (i = 0; i < pnn->cInput; i++)
+        FWRITE(pnn->arHiddenWeight + i * pnn->cHidden, pnn->cHiddenTrained);
+    for (i = 0; i < pnn->cOutput; i++)
+        for (j = 0; j < pnn->cHiddenTrained; j++)
+            FWRITE(pnn->arOutputWeight + NN_OUTPUT_WEIGHT(pnn, i, j), 1);
+    FWRITE(pnn->arHiddenThreshold, pnn->cHiddenTrained);
     FWRITE(pnn->arOutputThreshold, pnn->cOutput);
 #undef FWRITE
 
@@ -23,11 +23,25 @@
 
 #include <stdio.h>
 #include "common.h"
+#include "gnubg-types.h"
+
+/* Once loaded, cHidden is padded with zero weight nodes to a multiple
+ * of NN_HIDDEN_BLOCK, so that every input's column of arHiddenWeight is
+ * whole 64 byte cache lines and the vector loops need no tail.
+ * arOutputWeight is stored in blocks of NN_HIDDEN_BLOCK hidden nodes,
+ * each holding that stretch of every output row in turn, so the output
+ * layer reads the hidden activations in a single pass. */
+#define NN_HIDDEN_BLOCK 16
+
+/* index in arOutputWeight of the weight from hidden node j to output i */
+#define NN_OUTPUT_WEIGHT(pnn, i, j) \
+    ((((j) / NN_HIDDEN_BLOCK) * (pnn)->cOutput + (i)) * NN_HIDDEN_BLOCK + (j) % NN_HIDDEN_BLOCK)
 
 typedef struct _neuralnet {
     unsigned int cInput;
     unsigned int cHidden;
     unsigned int cOutput;
+    unsigned int cHiddenTrained;        /* cHidden without the padding */
     int nTrained;
     float rBetaHidden;
     float rBetaOutput;
@@ -35,12 +49,17 @@ typedef struct _neuralnet {
     float *arOutputWeight;
     float *arHiddenThreshold;
     float *arOutputThreshold;
+    /* fixed point copy of the weights, see NeuralNetQuantize() */
+    short *asHiddenWeight;
+    int *aiHiddenThreshold;
+    float *arHiddenScale;
 } neuralnet;
 
 typedef enum {
     NNEVAL_NONE,
     NNEVAL_SAVE,
-    NNEVAL_FROMBASE
+    NNEVAL_FROMBASE,
+    NNEVAL_PARENT
 } NNEvalType;
 
 typedef enum {
@@ -49,23 +68,53 @@ typedef enum {
     NNSTATE_DONE
 } NNStateType;
 
+/* Inputs and hidden layer sums of a base position.  With a known parent
+ * the base is the parent itself (its inputs as the positions after its
+ * moves are seen), so the positions reached from it (other moves, other
+ * rolls) come out the same whichever is evaluated first; they start from
+ * arHidden and only add the weight columns of the inputs that differ
+ * from arInput. */
+typedef struct _NNAccumulator {
+    const neuralnet *pnn;
+    positionkey keyParent;
+    float *arInput;
+    float *arHidden;
+} NNAccumulator;
+
+#define NN_ACCUMULATORS 4
+
 typedef struct _NNState {
     NNStateType state;
-    float *savedBase;
-    float *savedIBase;
-#if !defined(USE_SIMD_INSTRUCTIONS)
-    int cSavedIBase;
-#endif
+    /* parent of the positions evaluated in this context and its inputs;
+     * all zero when unknown, in which case the first position evaluated
+     * is the base */
+    positionkey keyParent;
+    const float *arParentInput;
+    NNAccumulator *pAccumulator;
+    unsigned int iReplace;
+    NNAccumulator aAccumulator[NN_ACCUMULATORS];
 } NNState;
 
+/* Number of positions NeuralNetEvaluateBatch() pushes through the
+ * hidden layer together */
+#define NN_BATCH_SIZE 16
+
 extern int NeuralNetCreate(neuralnet * pnn, unsigned int cInput, unsigned int cHidden, unsigned int cOutput,
                            float rBetaHidden, float rBetaOutput);
 extern void NeuralNetDestroy(neuralnet * pnn);
+extern int NNStateCreate(NNState * pnState, unsigned int cInput, unsigned int cHidden);
+extern void NNStateDestroy(NNState * pnState);
+extern NNEvalType NNevalAction(const neuralnet * pnn, NNState * pnState);
 #if !USE_SIMD_INSTRUCTIONS
 extern int NeuralNetEvaluate(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
 #else
 extern int NeuralNetEvaluateSSE(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
 #endif
+extern int NeuralNetEvaluateBatch(const neuralnet * pnn, unsigned int cBoards, float *aarInput[], float *aarOutput[]);
+extern int NeuralNetQuantize(neuralnet * pnn);
+extern void NeuralNetQuantizeFree(neuralnet * pnn);
+extern int NeuralNetEvaluateQuantized(const neuralnet * pnn, const float arInput[], float arOutput[]);
+extern void NeuralNetSigmoidError(float *prMaxTable, float *prMaxExact);
 extern int NeuralNetLoad(neuralnet * pnn, FILE * pf);
 extern int NeuralNetLoadBinary(neuralnet * pnn, FILE * pf);
 extern int NeuralNetSaveBinary(const neuralnet * pnn, FILE * pf);
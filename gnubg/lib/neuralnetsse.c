@@ -23,7 +23,7 @@
 #include "config.h"
 #include "common.h"
 
-#if USE_SIMD_INSTRUCTIONS
+#if USE_SIMD_INSTRUCTIONS && !defined(USE_WASM_SIMD)
 
 #define DEBUG_SSE 0
 
@@ -45,7 +45,7 @@
 float *
 sse_malloc(size_t size)
 {
-    return (float *) _mm_malloc(size, ALIGN_SIZE);
+    return (float *) _mm_malloc(size, CACHELINE_SIZE);
 }
 
 void
@@ -90,43 +90,72 @@ static const union {
 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF}};
 #endif
 
+/* e^(i/10) / 10 for the integers i in fi, computed as in sigmoid_poly() */
+
 static inline float_vector
-sigmoid_positive_ps(float_vector xin)
+exp_table_ps(float_vector fi)
 {
-    union {
-        int_vector i;
-        int32_t i32[VEC_SIZE];
-    } i;
-    float_vector ex;
-    float *ex_elem = (float *) &ex;
 #if defined(USE_AVX)
-    float_vector x1 = _mm256_min_ps(xin, tens.ps);
+    float_vector y = _mm256_min_ps(fi, _mm256_set1_ps(99.0f));
+    float_vector fn, r, p;
+    __m256i n;
+    __m128i n0, n1;
+
+    y = _mm256_sub_ps(_mm256_mul_ps(y, _mm256_set1_ps(0.1f)), _mm256_set1_ps(SIGMOID_LN10));
+    n = _mm256_cvtps_epi32(_mm256_mul_ps(y, _mm256_set1_ps(SIGMOID_LOG2E)));
+    fn = _mm256_cvtepi32_ps(n);
+    r = _mm256_sub_ps(y, _mm256_mul_ps(fn, _mm256_set1_ps(SIGMOID_LN2_HI)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(fn, _mm256_set1_ps(SIGMOID_LN2_LO)));
+
+    p = _mm256_set1_ps(SIGMOID_P0);
+    p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(SIGMOID_P1));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(SIGMOID_P2));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(SIGMOID_P3));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(SIGMOID_P4));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(SIGMOID_P5));
+    p = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(p, r), r), r), ones.ps);
+
+    /* 2^n, built in the exponent bits; AVX has no 256 bit integer
+     * arithmetic, so in two halves */
+    n0 = _mm_slli_epi32(_mm_add_epi32(_mm256_castsi256_si128(n), _mm_set1_epi32(127)), 23);
+    n1 = _mm_slli_epi32(_mm_add_epi32(_mm256_extractf128_si256(n, 1), _mm_set1_epi32(127)), 23);
+
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(n0), n1, 1)));
 #else
-    float_vector x1 = _mm_min_ps(xin, tens.ps);
+    float_vector y = _mm_min_ps(fi, _mm_set1_ps(99.0f));
+    float_vector fn, r, p;
+    __m128i n;
+
+    y = _mm_sub_ps(_mm_mul_ps(y, _mm_set1_ps(0.1f)), _mm_set1_ps(SIGMOID_LN10));
+    n = _mm_cvtps_epi32(_mm_mul_ps(y, _mm_set1_ps(SIGMOID_LOG2E)));
+    fn = _mm_cvtepi32_ps(n);
+    r = _mm_sub_ps(y, _mm_mul_ps(fn, _mm_set1_ps(SIGMOID_LN2_HI)));
+    r = _mm_sub_ps(r, _mm_mul_ps(fn, _mm_set1_ps(SIGMOID_LN2_LO)));
+
+    p = _mm_set1_ps(SIGMOID_P0);
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(SIGMOID_P1));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(SIGMOID_P2));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(SIGMOID_P3));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(SIGMOID_P4));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(SIGMOID_P5));
+    p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), r), ones.ps);
+
+    /* 2^n, built in the exponent bits */
+    n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+
+    return _mm_mul_ps(p, _mm_castsi128_ps(n));
 #endif
+}
 
+static inline float_vector
+sigmoid_positive_ps(float_vector xin)
+{
 #if defined(USE_AVX)
-    x1 = _mm256_mul_ps(x1, tens.ps);
-    i.i = _mm256_cvttps_epi32(x1);
-#else
-    x1 = _mm_mul_ps(x1, tens.ps);
-    i.i = _mm_cvttps_epi32(x1);
-#endif
-    ex_elem[0] = e[i.i32[0]];
-    ex_elem[1] = e[i.i32[1]];
-    ex_elem[2] = e[i.i32[2]];
-    ex_elem[3] = e[i.i32[3]];
-#if defined(USE_AVX)
-    ex_elem[4] = e[i.i32[4]];
-    ex_elem[5] = e[i.i32[5]];
-    ex_elem[6] = e[i.i32[6]];
-    ex_elem[7] = e[i.i32[7]];
-#endif
+    float_vector x1 = _mm256_mul_ps(_mm256_min_ps(xin, tens.ps), tens.ps);
+    float_vector fi = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(x1));
 
-#if defined(USE_AVX)
-    x1 = _mm256_sub_ps(x1, _mm256_cvtepi32_ps(i.i));
-    x1 = _mm256_add_ps(x1, tens.ps);
-    x1 = _mm256_mul_ps(x1, ex);
+    x1 = _mm256_add_ps(_mm256_sub_ps(tens.ps, fi), x1);
+    x1 = _mm256_mul_ps(exp_table_ps(fi), x1);
     x1 = _mm256_add_ps(x1, ones.ps);
 #ifdef __FAST_MATH__
     return _mm256_rcp_ps(x1);
@@ -134,9 +163,11 @@ sigmoid_positive_ps(float_vector xin)
     return _mm256_div_ps(ones.ps, x1);
 #endif
 #else
-    x1 = _mm_sub_ps(x1, _mm_cvtepi32_ps(i.i));
-    x1 = _mm_add_ps(x1, tens.ps);
-    x1 = _mm_mul_ps(x1, ex);
+    float_vector x1 = _mm_mul_ps(_mm_min_ps(xin, tens.ps), tens.ps);
+    float_vector fi = _mm_cvtepi32_ps(_mm_cvttps_epi32(x1));
+
+    x1 = _mm_add_ps(_mm_sub_ps(tens.ps, fi), x1);
+    x1 = _mm_mul_ps(exp_table_ps(fi), x1);
     x1 = _mm_add_ps(x1, ones.ps);
 #ifdef __FAST_MATH__
     return _mm_rcp_ps(x1);
@@ -201,17 +232,106 @@ for (j = (cHidden >> LOG2VEC_SIZE); j; j--, pr += VEC_SIZE, prWeight += VEC_SIZE
 }
 #endif
 
+/* Squash the hidden layer activities in ar[] and calculate the output nodes */
+
 static void
-EvaluateSSE(const neuralnet * pnn, const float arInput[], float ar[], float arOutput[])
+EvaluateOutputsSSE(const neuralnet * pnn, float ar[], float arOutput[])
 {
-
     const unsigned int cHidden = pnn->cHidden;
-    unsigned int i, j;
+    unsigned int i, j, k;
     float *prWeight;
 #if defined(USE_SSE2) || defined(USE_AVX)
     float *par;
 #endif
     float_vector vec0, vec1, vec3, scalevec, sum;
+    float_vector asum[pnn->cOutput];
+
+#if defined(USE_SSE2) || defined(USE_AVX)
+#if defined(USE_AVX)
+    scalevec = _mm256_set1_ps(pnn->rBetaHidden);
+#else
+    scalevec = _mm_set1_ps(pnn->rBetaHidden);
+#endif
+    for (par = ar, i = (cHidden >> LOG2VEC_SIZE); i; i--, par += VEC_SIZE) {
+#if defined(USE_AVX)
+        float_vector vec = _mm256_load_ps(par);
+        vec = _mm256_mul_ps(vec, scalevec);
+        vec = sigmoid_ps(vec);
+        _mm256_store_ps(par, vec);
+#else
+        float_vector vec = _mm_load_ps(par);
+        vec = _mm_mul_ps(vec, scalevec);
+        vec = sigmoid_ps(vec);
+        _mm_store_ps(par, vec);
+#endif
+    }
+#else
+    sigmoid_vector(ar, cHidden, -pnn->rBetaHidden);
+#endif
+
+    /* Calculate activity at output nodes, all of them in one pass over
+     * the interleaved arOutputWeight */
+    for (i = 0; i < pnn->cOutput; i++)
+#if defined(USE_AVX)
+        asum[i] = _mm256_setzero_ps();
+#else
+        asum[i] = _mm_setzero_ps();
+#endif
+
+    prWeight = pnn->arOutputWeight;
+
+    for (j = 0; j < cHidden; j += NN_HIDDEN_BLOCK)
+        for (i = 0; i < pnn->cOutput; i++)
+            for (k = 0; k < NN_HIDDEN_BLOCK; k += VEC_SIZE, prWeight += VEC_SIZE) {
+#if defined(USE_AVX)
+                vec0 = _mm256_load_ps(ar + j + k);      /* Eight floats into vec0 */
+                vec1 = _mm256_load_ps(prWeight);        /* Eight weights into vec1 */
+                vec3 = _mm256_mul_ps(vec0, vec1);       /* Multiply */
+                asum[i] = _mm256_add_ps(asum[i], vec3); /* Add */
+#else
+                vec0 = _mm_load_ps(ar + j + k); /* Four floats into vec0 */
+                vec1 = _mm_load_ps(prWeight);   /* Four weights into vec1 */
+                vec3 = _mm_mul_ps(vec0, vec1);  /* Multiply */
+                asum[i] = _mm_add_ps(asum[i], vec3);    /* Add */
+#endif
+            }
+
+    for (i = 0; i < pnn->cOutput; i++) {
+#if defined(USE_AVX)
+        SSE_ALIGN(float r[8]);
+
+        sum = asum[i];
+        vec0 = _mm256_hadd_ps(sum, sum);
+        vec1 = _mm256_hadd_ps(vec0, vec0);
+        _mm256_store_ps(r, vec1);
+
+        arOutput[i] = sigmoid(-pnn->rBetaOutput * (r[0] + r[4] + pnn->arOutputThreshold[i]));
+#else
+        float r;
+
+        sum = asum[i];
+        vec0 = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1));
+        vec1 = _mm_add_ps(sum, vec0);
+        vec0 = _mm_shuffle_ps(vec1, vec1, _MM_SHUFFLE(1, 1, 3, 3));
+        sum = _mm_add_ps(vec1, vec0);
+        _mm_store_ss(&r, sum);
+
+        arOutput[i] = sigmoid(-pnn->rBetaOutput * (r + pnn->arOutputThreshold[i]));
+#endif
+    }
+#if defined(USE_AVX)
+    _mm256_zeroupper();
+#endif
+}
+
+static void
+EvaluateSSE(const neuralnet * pnn, const float arInput[], float ar[], float arOutput[], float *saveAr)
+{
+
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j;
+    float *prWeight;
+    float_vector vec0, vec1, vec3, scalevec, sum;
 
     /* Calculate activity at hidden nodes */
     memcpy(ar, pnn->arHiddenThreshold, cHidden * sizeof(float));
@@ -313,85 +433,55 @@ EvaluateSSE(const neuralnet * pnn, const float arInput[], float ar[], float arOu
             }
         }
 
-#if defined(USE_SSE2) || defined(USE_AVX)
-#if defined(USE_AVX)
-    scalevec = _mm256_set1_ps(pnn->rBetaHidden);
-#else
-    scalevec = _mm_set1_ps(pnn->rBetaHidden);
-#endif
-    for (par = ar, i = (cHidden >> LOG2VEC_SIZE); i; i--, par += VEC_SIZE) {
-#if defined(USE_AVX)
-        float_vector vec = _mm256_load_ps(par);
-        vec = _mm256_mul_ps(vec, scalevec);
-        vec = sigmoid_ps(vec);
-        _mm256_store_ps(par, vec);
-#else
-        float_vector vec = _mm_load_ps(par);
-        vec = _mm_mul_ps(vec, scalevec);
-        vec = sigmoid_ps(vec);
-        _mm_store_ps(par, vec);
-#endif
-    }
-#else
-    for (i = 0; i < cHidden; i++)
-        ar[i] = sigmoid(-pnn->rBetaHidden * ar[i]);
-#endif
+    if (saveAr)
+        memcpy(saveAr, ar, cHidden * sizeof(*saveAr));
 
-    /* Calculate activity at output nodes */
-    prWeight = pnn->arOutputWeight;
+    EvaluateOutputsSSE(pnn, ar, arOutput);
+}
 
-    for (i = 0; i < pnn->cOutput; i++) {
+/* Start from the hidden layer sums of the accumulator and add the
+ * weight columns of the inputs that differ from its inputs */
 
-#if defined(USE_AVX)
-        SSE_ALIGN(float r[8]);
-#else
-        float r;
-#endif
-        float *pr = ar;
-#if defined(USE_AVX)
-        sum = _mm256_setzero_ps();
-#else
-        sum = _mm_setzero_ps();
-#endif
-        for (j = (cHidden >> LOG2VEC_SIZE); j; j--, prWeight += VEC_SIZE, pr += VEC_SIZE) {
-#if defined(USE_AVX)
-            vec0 = _mm256_load_ps(pr);  /* Eight floats into vec0 */
-            vec1 = _mm256_load_ps(prWeight);    /* Eight weights into vec1 */
-            vec3 = _mm256_mul_ps(vec0, vec1);   /* Multiply */
-            sum = _mm256_add_ps(sum, vec3);     /* Add */
-#else
-            vec0 = _mm_load_ps(pr);     /* Four floats into vec0 */
-            vec1 = _mm_load_ps(prWeight);       /* Four weights into vec1 */
-            vec3 = _mm_mul_ps(vec0, vec1);      /* Multiply */
-            sum = _mm_add_ps(sum, vec3);        /* Add */
-#endif
-        }
+static void
+EvaluateFromBaseSSE(const neuralnet * pnn, const float arInput[], const NNAccumulator * pacc, float ar[],
+                    float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j;
+    float *prWeight;
+    float_vector vec0, vec1, vec3, scalevec, sum;
 
-#if defined(USE_AVX)
-        vec0 = _mm256_hadd_ps(sum, sum);
-        vec1 = _mm256_hadd_ps(vec0, vec0);
-        _mm256_store_ps(r, vec1);
+    memcpy(ar, pacc->arHidden, cHidden * sizeof(float));
 
-        _mm256_zeroupper();
+    prWeight = pnn->arHiddenWeight;
 
-        arOutput[i] = sigmoid(-pnn->rBetaOutput * (r[0] + r[4] + pnn->arOutputThreshold[i]));
+    for (i = 0; i < pnn->cInput; i++) {
+        float const ari = arInput[i] - pacc->arInput[i];
 
-#else
-        vec0 = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1));
-        vec1 = _mm_add_ps(sum, vec0);
-        vec0 = _mm_shuffle_ps(vec1, vec1, _MM_SHUFFLE(1, 1, 3, 3));
-        sum = _mm_add_ps(vec1, vec0);
-        _mm_store_ss(&r, sum);
+        if (ari == 0.0f)
+            prWeight += cHidden;
+        else {
+            float *pr = ar;
 
-        arOutput[i] = sigmoid(-pnn->rBetaOutput * (r + pnn->arOutputThreshold[i]));
+            if (ari == 1.0f) {
+                INPUT_ADD();
+            } else {
+#if defined(USE_AVX)
+                scalevec = _mm256_set1_ps(ari);
+#else
+                scalevec = _mm_set1_ps(ari);
 #endif
+                INPUT_MULTADD();
+            }
+        }
     }
-}
 
+    EvaluateOutputsSSE(pnn, ar, arOutput);
+}
 
 extern int
 NeuralNetEvaluateSSE(const neuralnet * pnn, /*lint -e{818} */ float arInput[],
-                     float arOutput[], NNState * UNUSED(pnState))
+                     float arOutput[], NNState * pnState)
 {
     SSE_ALIGN(float ar[pnn->cHidden]);
 
@@ -401,7 +491,73 @@ NeuralNetEvaluateSSE(const neuralnet * pnn, /*lint -e{818} */ float arInput[],
     g_assert(sse_aligned(arInput));
 #endif
 
-    EvaluateSSE(pnn, arInput, ar, arOutput);
+    switch (NNevalAction(pnn, pnState)) {
+    case NNEVAL_NONE:
+        EvaluateSSE(pnn, arInput, ar, arOutput, NULL);
+        break;
+    case NNEVAL_SAVE:
+        memcpy(pnState->pAccumulator->arInput, arInput, pnn->cInput * sizeof(float));
+        EvaluateSSE(pnn, arInput, ar, arOutput, pnState->pAccumulator->arHidden);
+        break;
+    case NNEVAL_PARENT:
+        /* the base is the parent */
+        memcpy(pnState->pAccumulator->arInput, pnState->arParentInput, pnn->cInput * sizeof(float));
+        EvaluateSSE(pnn, pnState->arParentInput, ar, arOutput, pnState->pAccumulator->arHidden);
+        /* fall through */
+    case NNEVAL_FROMBASE:
+        EvaluateFromBaseSSE(pnn, arInput, pnState->pAccumulator, ar, arOutput);
+        break;
+    }
+    return 0;
+}
+
+/* Evaluate up to NN_BATCH_SIZE input vectors at once, reading each
+ * column of arHiddenWeight once per batch (see neuralnet.c) */
+
+static void
+EvaluateBatchSSE(const neuralnet * pnn, unsigned int cBoards, float *aarInput[], float ar[], float *aarOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j, k;
+    float_vector vec0, vec1, vec3, scalevec, sum;
+
+    for (k = 0; k < cBoards; k++)
+        memcpy(ar + k * cHidden, pnn->arHiddenThreshold, cHidden * sizeof(float));
+
+    for (i = 0; i < pnn->cInput; i++) {
+        for (k = 0; k < cBoards; k++) {
+            float const ari = aarInput[k][i];
+            float *pr = ar + k * cHidden;
+            float *prWeight = pnn->arHiddenWeight + i * cHidden;
+
+            if (ari == 0.0f)
+                continue;
+            else if (ari == 1.0f) {
+                INPUT_ADD();
+            } else {
+#if defined(USE_AVX)
+                scalevec = _mm256_set1_ps(ari);
+#else
+                scalevec = _mm_set1_ps(ari);
+#endif
+                INPUT_MULTADD();
+            }
+        }
+    }
+
+    for (k = 0; k < cBoards; k++)
+        EvaluateOutputsSSE(pnn, ar + k * cHidden, aarOutput[k]);
+}
+
+extern int
+NeuralNetEvaluateBatch(const neuralnet * pnn, unsigned int cBoards, float *aarInput[], float *aarOutput[])
+{
+    SSE_ALIGN(float ar[NN_BATCH_SIZE * pnn->cHidden]);
+    unsigned int i;
+
+    for (i = 0; i < cBoards; i += NN_BATCH_SIZE)
+        EvaluateBatchSSE(pnn, MIN(NN_BATCH_SIZE, cBoards - i), aarInput + i, ar, aarOutput + i);
+
     return 0;
 }
 
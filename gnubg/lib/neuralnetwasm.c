@@ -0,0 +1,307 @@
+/*
+ * neuralnetwasm.c
+ *
+ * WebAssembly SIMD128 specific code, selected when the web build is
+ * compiled with emcc -msimd128
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 or later of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "config.h"
+#include "common.h"
+
+#if USE_WASM_SIMD
+
+#define DEBUG_SSE 0
+
+#include "simd.h"
+#include "neuralnet.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include "sigmoid.h"
+
+float *
+sse_malloc(size_t size)
+{
+    void *ptr;
+
+    if (posix_memalign(&ptr, CACHELINE_SIZE, size))
+        return NULL;
+
+    return (float *) ptr;
+}
+
+void
+sse_free(float *ptr)
+{
+    free(ptr);
+}
+
+/* e^(i/10) / 10 for the integers i in fi, computed as in sigmoid_poly() */
+
+static inline float_vector
+exp_table_ps(float_vector fi)
+{
+    float_vector y = wasm_f32x4_min(fi, wasm_f32x4_splat(99.0f));
+    float_vector fn, r, p;
+    int_vector n;
+
+    y = wasm_f32x4_sub(wasm_f32x4_mul(y, wasm_f32x4_splat(0.1f)), wasm_f32x4_splat(SIGMOID_LN10));
+    fn = wasm_f32x4_nearest(wasm_f32x4_mul(y, wasm_f32x4_splat(SIGMOID_LOG2E)));
+    n = wasm_i32x4_trunc_sat_f32x4(fn);
+    r = wasm_f32x4_sub(y, wasm_f32x4_mul(fn, wasm_f32x4_splat(SIGMOID_LN2_HI)));
+    r = wasm_f32x4_sub(r, wasm_f32x4_mul(fn, wasm_f32x4_splat(SIGMOID_LN2_LO)));
+
+    p = wasm_f32x4_splat(SIGMOID_P0);
+    p = wasm_f32x4_add(wasm_f32x4_mul(p, r), wasm_f32x4_splat(SIGMOID_P1));
+    p = wasm_f32x4_add(wasm_f32x4_mul(p, r), wasm_f32x4_splat(SIGMOID_P2));
+    p = wasm_f32x4_add(wasm_f32x4_mul(p, r), wasm_f32x4_splat(SIGMOID_P3));
+    p = wasm_f32x4_add(wasm_f32x4_mul(p, r), wasm_f32x4_splat(SIGMOID_P4));
+    p = wasm_f32x4_add(wasm_f32x4_mul(p, r), wasm_f32x4_splat(SIGMOID_P5));
+    p = wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_mul(wasm_f32x4_mul(p, r), r), r), wasm_f32x4_splat(1.0f));
+
+    /* 2^n, built in the exponent bits */
+    n = wasm_i32x4_shl(wasm_i32x4_add(n, wasm_i32x4_splat(127)), 23);
+
+    return wasm_f32x4_mul(p, n);
+}
+
+/* Same approximation as sigmoid() in sigmoid.h, four lanes at a time,
+ * with the table replaced by exp_table_ps() */
+
+static inline float_vector
+sigmoid_positive_ps(float_vector xin)
+{
+    const float_vector ones = wasm_f32x4_splat(1.0f);
+    const float_vector tens = wasm_f32x4_splat(10.0f);
+    float_vector x1 = wasm_f32x4_mul(wasm_f32x4_min(xin, tens), tens);
+    float_vector fi = wasm_f32x4_convert_i32x4(wasm_i32x4_trunc_sat_f32x4(x1));
+
+    x1 = wasm_f32x4_add(wasm_f32x4_sub(tens, fi), x1);
+    x1 = wasm_f32x4_mul(exp_table_ps(fi), x1);
+    x1 = wasm_f32x4_add(x1, ones);
+
+    return wasm_f32x4_div(ones, x1);
+}
+
+static inline float_vector
+sigmoid_ps(float_vector xin)
+{
+    float_vector mask = wasm_f32x4_lt(xin, wasm_f32x4_splat(0.0f));
+    float_vector c = sigmoid_positive_ps(wasm_f32x4_abs(xin));
+
+    return wasm_v128_bitselect(c, wasm_f32x4_sub(wasm_f32x4_splat(1.0f), c), mask);
+}
+
+static inline float
+horizontal_sum(float_vector sum)
+{
+    return wasm_f32x4_extract_lane(sum, 0) + wasm_f32x4_extract_lane(sum, 1) +
+        wasm_f32x4_extract_lane(sum, 2) + wasm_f32x4_extract_lane(sum, 3);
+}
+
+#define INPUT_ADD() \
+for (j = (cHidden >> LOG2VEC_SIZE); j; j--, pr += VEC_SIZE, prWeight += VEC_SIZE) \
+    wasm_v128_store(pr, wasm_f32x4_add(wasm_v128_load(pr), wasm_v128_load(prWeight)));
+
+#define INPUT_MULTADD() \
+for (j = (cHidden >> LOG2VEC_SIZE); j; j--, pr += VEC_SIZE, prWeight += VEC_SIZE) \
+    wasm_v128_store(pr, wasm_f32x4_add(wasm_v128_load(pr), \
+                                       wasm_f32x4_mul(wasm_v128_load(prWeight), scalevec)));
+
+/* Squash the hidden layer activities in ar[] and calculate the output nodes */
+
+static void
+EvaluateOutputsWasm(const neuralnet * pnn, float ar[], float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j, k;
+    const float *prWeight;
+    float *par;
+    float_vector scalevec = wasm_f32x4_splat(pnn->rBetaHidden);
+    float_vector asum[pnn->cOutput];
+
+    for (par = ar, i = (cHidden >> LOG2VEC_SIZE); i; i--, par += VEC_SIZE)
+        wasm_v128_store(par, sigmoid_ps(wasm_f32x4_mul(wasm_v128_load(par), scalevec)));
+
+    /* Calculate activity at output nodes, all of them in one pass over
+     * the interleaved arOutputWeight */
+    for (i = 0; i < pnn->cOutput; i++)
+        asum[i] = wasm_f32x4_splat(0.0f);
+
+    prWeight = pnn->arOutputWeight;
+
+    for (j = 0; j < cHidden; j += NN_HIDDEN_BLOCK)
+        for (i = 0; i < pnn->cOutput; i++)
+            for (k = 0; k < NN_HIDDEN_BLOCK; k += VEC_SIZE, prWeight += VEC_SIZE)
+                asum[i] = wasm_f32x4_add(asum[i], wasm_f32x4_mul(wasm_v128_load(ar + j + k),
+                                                                 wasm_v128_load(prWeight)));
+
+    for (i = 0; i < pnn->cOutput; i++)
+        arOutput[i] = sigmoid(-pnn->rBetaOutput * (horizontal_sum(asum[i]) + pnn->arOutputThreshold[i]));
+}
+
+static void
+EvaluateWasm(const neuralnet * pnn, const float arInput[], float ar[], float arOutput[], float *saveAr)
+{
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j;
+    const float *prWeight;
+    float_vector scalevec;
+
+    /* Calculate activity at hidden nodes */
+    memcpy(ar, pnn->arHiddenThreshold, cHidden * sizeof(float));
+
+    prWeight = pnn->arHiddenWeight;
+
+    for (i = 0; i < pnn->cInput; i++) {
+        float const ari = arInput[i];
+
+        if (ari == 0.0f)
+            prWeight += cHidden;
+        else {
+            float *pr = ar;
+
+            if (ari == 1.0f) {
+                INPUT_ADD();
+            } else {
+                scalevec = wasm_f32x4_splat(ari);
+                INPUT_MULTADD();
+            }
+        }
+    }
+
+    if (saveAr)
+        memcpy(saveAr, ar, cHidden * sizeof(*saveAr));
+
+    EvaluateOutputsWasm(pnn, ar, arOutput);
+}
+
+/* Start from the hidden layer sums of the accumulator and add the
+ * weight columns of the inputs that differ from its inputs */
+
+static void
+EvaluateFromBaseWasm(const neuralnet * pnn, const float arInput[], const NNAccumulator * pacc, float ar[],
+                     float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j;
+    const float *prWeight;
+    float_vector scalevec;
+
+    memcpy(ar, pacc->arHidden, cHidden * sizeof(float));
+
+    prWeight = pnn->arHiddenWeight;
+
+    for (i = 0; i < pnn->cInput; i++) {
+        float const ari = arInput[i] - pacc->arInput[i];
+
+        if (ari == 0.0f)
+            prWeight += cHidden;
+        else {
+            float *pr = ar;
+
+            if (ari == 1.0f) {
+                INPUT_ADD();
+            } else {
+                scalevec = wasm_f32x4_splat(ari);
+                INPUT_MULTADD();
+            }
+        }
+    }
+
+    EvaluateOutputsWasm(pnn, ar, arOutput);
+}
+
+extern int
+NeuralNetEvaluateSSE(const neuralnet * pnn, /*lint -e{818} */ float arInput[],
+                     float arOutput[], NNState * pnState)
+{
+    SSE_ALIGN(float ar[pnn->cHidden]);
+
+#if DEBUG_SSE
+    g_assert(sse_aligned(arOutput));
+    g_assert(sse_aligned(ar));
+    g_assert(sse_aligned(arInput));
+#endif
+
+    switch (NNevalAction(pnn, pnState)) {
+    case NNEVAL_NONE:
+        EvaluateWasm(pnn, arInput, ar, arOutput, NULL);
+        break;
+    case NNEVAL_SAVE:
+        memcpy(pnState->pAccumulator->arInput, arInput, pnn->cInput * sizeof(float));
+        EvaluateWasm(pnn, arInput, ar, arOutput, pnState->pAccumulator->arHidden);
+        break;
+    case NNEVAL_PARENT:
+        /* the base is the parent */
+        memcpy(pnState->pAccumulator->arInput, pnState->arParentInput, pnn->cInput * sizeof(float));
+        EvaluateWasm(pnn, pnState->arParentInput, ar, arOutput, pnState->pAccumulator->arHidden);
+        /* fall through */
+    case NNEVAL_FROMBASE:
+        EvaluateFromBaseWasm(pnn, arInput, pnState->pAccumulator, ar, arOutput);
+        break;
+    }
+    return 0;
+}
+
+/* Evaluate up to NN_BATCH_SIZE input vectors at once, reading each
+ * column of arHiddenWeight once per batch (see neuralnet.c) */
+
+static void
+EvaluateBatchWasm(const neuralnet * pnn, unsigned int cBoards, float *aarInput[], float ar[], float *aarOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j, k;
+    float_vector scalevec;
+
+    for (k = 0; k < cBoards; k++)
+        memcpy(ar + k * cHidden, pnn->arHiddenThreshold, cHidden * sizeof(float));
+
+    for (i = 0; i < pnn->cInput; i++) {
+        for (k = 0; k < cBoards; k++) {
+            float const ari = aarInput[k][i];
+            float *pr = ar + k * cHidden;
+            const float *prWeight = pnn->arHiddenWeight + i * cHidden;
+
+            if (ari == 0.0f)
+                continue;
+            else if (ari == 1.0f) {
+                INPUT_ADD();
+            } else {
+                scalevec = wasm_f32x4_splat(ari);
+                INPUT_MULTADD();
+            }
+        }
+    }
+
+    for (k = 0; k < cBoards; k++)
+        EvaluateOutputsWasm(pnn, ar + k * cHidden, aarOutput[k]);
+}
+
+extern int
+NeuralNetEvaluateBatch(const neuralnet * pnn, unsigned int cBoards, float *aarInput[], float *aarOutput[])
+{
+    SSE_ALIGN(float ar[NN_BATCH_SIZE * pnn->cHidden]);
+    unsigned int i;
+
+    for (i = 0; i < cBoards; i += NN_BATCH_SIZE)
+        EvaluateBatchWasm(pnn, MIN(NN_BATCH_SIZE, cBoards - i), aarInput + i, ar, aarOutput + i);
+
+    return 0;
+}
+
+#endif
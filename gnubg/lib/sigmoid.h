@@ -21,6 +21,9 @@
 
 #ifndef SIGMOID_H
 #define SIGMOID_H
+
+#include <math.h>
+
 /* e[k] = exp(k/10) / 10 */
 static float e[101] = {
     0.10000000000000001f,
@@ -165,4 +168,72 @@ sigmoid(float const xin)
 }
 
 
+/* Table free version of sigmoid(), used to squash the hidden layer.
+ *
+ * It keeps the same interpolation, e^x ~= e^(k/10) * (1 + x - k/10)
+ * with k = floor(10x), since the nets were trained with it: the exact
+ * 1 / ( 1 + e^x ) moves 2-ply equities by a hundredth.  Only e^(k/10)
+ * is computed instead of looked up, as 2^n * e^r with |r| <= ln(2) / 2
+ * and the polynomial of the Cephes expf().  With no branches or
+ * lookups the loop in sigmoid_vector() can be vectorised;
+ * neuralnetsse.c and neuralnetwasm.c have the same computation written
+ * with intrinsics.
+ *
+ * Measured over every float, the result differs from sigmoid() by at
+ * most 1.2e-7.  Both differ from 1 / ( 1 + expf( x ) ) by up to 1.2e-3,
+ * the error of the interpolation. */
+
+#define SIGMOID_LN10 2.30258509299404568f
+#define SIGMOID_LOG2E 1.44269504088896341f
+#define SIGMOID_LN2_HI 0.693359375f
+#define SIGMOID_LN2_LO -2.12194440e-4f
+#define SIGMOID_P0 1.9875691500e-4f
+#define SIGMOID_P1 1.3981999507e-3f
+#define SIGMOID_P2 8.3334519073e-3f
+#define SIGMOID_P3 4.1665795894e-2f
+#define SIGMOID_P4 1.6666665459e-1f
+#define SIGMOID_P5 5.0000001201e-1f
+
+static inline float
+sigmoid_poly(float const xin)
+{
+    float const ax = fabsf(xin) < 10.0f ? fabsf(xin) : 10.0f;
+    float const x1 = 10.0f * ax;
+    int const i = (int) x1;
+    /* e[ i ] = e^(i/10) / 10, and e[ 100 ] = e[ 99 ] */
+    float const y = (float) (i < 99 ? i : 99) * 0.1f - SIGMOID_LN10;
+    int const n = (int) rintf(y * SIGMOID_LOG2E);
+    float const r = y - (float) n * SIGMOID_LN2_HI - (float) n * SIGMOID_LN2_LO;
+    float p, s;
+    union {
+        int i;
+        float r;
+    } pow2n;
+
+    p = SIGMOID_P0;
+    p = p * r + SIGMOID_P1;
+    p = p * r + SIGMOID_P2;
+    p = p * r + SIGMOID_P3;
+    p = p * r + SIGMOID_P4;
+    p = p * r + SIGMOID_P5;
+    p = p * r * r + r + 1.0f;
+
+    pow2n.i = (n + 127) << 23;
+
+    s = 1.0f / (1.0f + p * pow2n.r * ((10 - i) + x1));
+
+    return xin >= 0.0f ? s : 1.0f - s;
+}
+
+/* ar[ i ] = sigmoid_poly( rScale * ar[ i ] ) for the whole vector */
+
+static inline void
+sigmoid_vector(float ar[], unsigned int n, float const rScale)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        ar[i] = sigmoid_poly(rScale * ar[i]);
+}
+
 #endif
@@ -22,7 +22,14 @@
 
 #include <stdlib.h>
 
-#ifdef USE_AVX
+#if defined(USE_WASM_SIMD)
+#include <wasm_simd128.h>
+#define ALIGN_SIZE 16
+#define VEC_SIZE 4
+#define LOG2VEC_SIZE 2
+#define float_vector v128_t
+#define int_vector v128_t
+#elif defined(USE_AVX)
 #define ALIGN_SIZE 32
 #define VEC_SIZE 8
 #define LOG2VEC_SIZE 3
@@ -57,6 +64,10 @@
 
 #define sse_aligned(ar) (!(((size_t)ar) % ALIGN_SIZE))
 
+/* sse_malloc() aligns to whole cache lines, so that the padded weight
+ * columns (see neuralnet.h) never straddle one */
+#define CACHELINE_SIZE 64
+
 extern float *sse_malloc(size_t size);
 extern void sse_free(float *ptr);
 
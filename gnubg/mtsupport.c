@@ -46,22 +46,17 @@ MT_CreateThreadLocalData(int id)
     ThreadLocalData *tld = (ThreadLocalData *) malloc(sizeof(ThreadLocalData));
     tld->id = id;
     tld->pnnState = (NNState *) malloc(sizeof(NNState) * 3);
-    memset(tld->pnnState, 0, sizeof(NNState) * 3);
-    tld->pnnState[CLASS_RACE - CLASS_RACE].savedBase = malloc(nnRace.cHidden * sizeof(float));
-    memset(tld->pnnState[CLASS_RACE - CLASS_RACE].savedBase, 0, nnRace.cHidden * sizeof(float));
-    tld->pnnState[CLASS_RACE - CLASS_RACE].savedIBase = malloc(nnRace.cInput * sizeof(float));
-    memset(tld->pnnState[CLASS_RACE - CLASS_RACE].savedIBase, 0, nnRace.cInput * sizeof(float));
-    tld->pnnState[CLASS_CRASHED - CLASS_RACE].savedBase = malloc(nnCrashed.cHidden * sizeof(float));
-    memset(tld->pnnState[CLASS_CRASHED - CLASS_RACE].savedBase, 0, nnCrashed.cHidden * sizeof(float));
-    tld->pnnState[CLASS_CRASHED - CLASS_RACE].savedIBase = malloc(nnCrashed.cInput * sizeof(float));
-    memset(tld->pnnState[CLASS_CRASHED - CLASS_RACE].savedIBase, 0, nnCrashed.cInput * sizeof(float));
-    tld->pnnState[CLASS_CONTACT - CLASS_RACE].savedBase = malloc(nnContact.cHidden * sizeof(float));
-    memset(tld->pnnState[CLASS_CONTACT - CLASS_RACE].savedBase, 0, nnContact.cHidden * sizeof(float));
-    tld->pnnState[CLASS_CONTACT - CLASS_RACE].savedIBase = malloc(nnContact.cInput * sizeof(float));
-    memset(tld->pnnState[CLASS_CONTACT - CLASS_RACE].savedIBase, 0, nnContact.cInput * sizeof(float));
-
-    tld->aMoves = (move *) malloc(sizeof(move) * MAX_INCOMPLETE_MOVES);
-    memset(tld->aMoves, 0, sizeof(move) * MAX_INCOMPLETE_MOVES);
+    /* the same states serve the pruning nets in FindBestMoveInEval() */
+    NNStateCreate(&tld->pnnState[CLASS_RACE - CLASS_RACE], MAX(nnRace.cInput, nnpRace.cInput),
+                  MAX(nnRace.cHidden, nnpRace.cHidden));
+    NNStateCreate(&tld->pnnState[CLASS_CRASHED - CLASS_RACE], MAX(nnCrashed.cInput, nnpCrashed.cInput),
+                  MAX(nnCrashed.cHidden, nnpCrashed.cHidden));
+    NNStateCreate(&tld->pnnState[CLASS_CONTACT - CLASS_RACE], MAX(nnContact.cInput, nnpContact.cInput),
+                  MAX(nnContact.cHidden, nnpContact.cHidden));
+
+    tld->aMoves = (movecand *) malloc(sizeof(movecand) * MAX_INCOMPLETE_MOVES);
+    memset(tld->aMoves, 0, sizeof(movecand) * MAX_INCOMPLETE_MOVES);
+    tld->pMoveHash = (movehash *) calloc(1, sizeof(movehash));
     return tld;
 }
 
@@ -386,11 +381,10 @@ CloseThread(void *UNUSED(unused))
     ThreadLocalData *pTLD = (ThreadLocalData *) TLSGet(td.tlsItem);
     if (pTLD->aMoves)
         free(pTLD->aMoves);
+    free(pTLD->pMoveHash);
 
-    for (i = 0; i < 3; i++) {
-        free(pnnState[i].savedBase);
-        free(pnnState[i].savedIBase);
-    }
+    for (i = 0; i < 3; i++)
+        NNStateDestroy(&pnnState[i]);
     free(((ThreadLocalData *) TLSGet(td.tlsItem))->pnnState);
     free((void *) TLSGet(td.tlsItem));
     MT_SafeInc(&td.result);
@@ -514,11 +508,10 @@ MT_Close(void)
         return;
 
     free(td.tld->aMoves);
+    free(td.tld->pMoveHash);
     pnnState = td.tld->pnnState;
-    for (i = 0; i < 3; i++) {
-        free(pnnState[i].savedBase);
-        free(pnnState[i].savedIBase);
-    }
+    for (i = 0; i < 3; i++)
+        NNStateDestroy(&pnnState[i]);
     free(pnnState);
     free(td.tld);
 }
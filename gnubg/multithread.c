@@ -31,6 +31,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <glib.h>
+#if defined(WEB)
+#include <unistd.h>
+#endif
 #if USE_GTK
 #include <gtk/gtk.h>
 #include <gtkgame.h>
@@ -280,7 +283,12 @@ WaitForAllTasks(int time)
             return FALSE;       /* Not done yet */
 
         j++;
+#if defined(WEB)
+        /* the web build leaves out glib's gtimer.c, g_usleep with it */
+        usleep(100 * time);
+#else
         g_usleep(100 * time);
+#endif
     }
     return TRUE;
 }
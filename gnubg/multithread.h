@@ -56,7 +56,8 @@ typedef struct _AnalyseMoveTask {
 
 typedef struct _ThreadLocalData {
     int id;
-    move *aMoves;
+    movecand *aMoves;
+    movehash *pMoveHash;
     NNState *pnnState;
 } ThreadLocalData;
 
@@ -183,6 +184,7 @@ extern unsigned int MT_GetNumThreads(void);
 #define MT_GetThreadID() ((ThreadLocalData *)TLSGet(td.tlsItem))->id
 #define MT_Get_nnState() ((ThreadLocalData *)TLSGet(td.tlsItem))->pnnState
 #define MT_Get_aMoves() ((ThreadLocalData *)TLSGet(td.tlsItem))->aMoves
+#define MT_Get_MoveHash() ((ThreadLocalData *)TLSGet(td.tlsItem))->pMoveHash
 
 #if defined (GLIB_THREADS)
 #if GLIB_CHECK_VERSION (2,30,0)
@@ -227,6 +229,7 @@ extern int asyncRet;
 #define MT_GetThreadID() 0
 #define MT_Get_nnState() td.tld->pnnState
 #define MT_Get_aMoves() td.tld->aMoves
+#define MT_Get_MoveHash() td.tld->pMoveHash
 #define MT_GetTLD() td.tld
 
 #endif
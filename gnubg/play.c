@@ -972,7 +972,7 @@ parse_move_is_legal(char *sz, const matchstate * pms, int *an)
 {
     int c;
     TanBoard anBoardNew;
-    movelist ml;
+    movecandlist ml;
     c = ParseMove(sz, an);
     if (c < 0)
         return FALSE;
@@ -984,6 +984,99 @@ parse_move_is_legal(char *sz, const matchstate * pms, int *an)
 }
 
 
+/* Find the computer player's move with *pec, which pfd->pec points to.
+ * Given nTime milliseconds, search at 0 plies, then 1 ply and so on up
+ * to pec->nPlies, stopping when the time runs out; pfd->pml and
+ * pec->nPlies are left as the deepest search that completed. */
+static int
+ComputerFindMove(findData * pfd, evalcontext * pec, unsigned int nTime)
+{
+
+    movelist *pml = pfd->pml;
+    movelist ml;
+    unsigned int n, nPlies = pec->nPlies;
+    int ret = 0;
+
+    if (!nTime)
+        return RunAsyncProcess((AsyncFun) asyncFindMove, pfd, _("Considering move..."));
+
+    pml->cMoves = 0;
+    pml->amMoves = NULL;
+    pfd->pml = &ml;
+    rEvalDeadline = get_time() + nTime;
+    fEvalDeadlinePassed = FALSE;
+
+    for (n = 0; n <= nPlies; n++) {
+
+        pec->nPlies = n;
+
+        if (RunAsyncProcess((AsyncFun) asyncFindMove, pfd, _("Considering move...")) != 0 || fInterrupt) {
+            if (n > 0 && fEvalDeadlinePassed) {
+                fInterrupt = FALSE;
+                pec->nPlies = n - 1;
+            } else {
+                free(pml->amMoves);
+                pml->cMoves = 0;
+                pml->amMoves = NULL;
+                ret = -1;
+            }
+            break;
+        }
+
+        free(pml->amMoves);
+        *pml = ml;
+
+        if (get_time() >= rEvalDeadline)
+            break;
+    }
+
+    rEvalDeadline = 0.0;
+    pfd->pml = pml;
+
+    return ret;
+}
+
+/* As ComputerFindMove(), for the cube decision with pdd->pes */
+static int
+ComputerCubeDecision(decisionData * pdd, unsigned int nTime)
+{
+
+    float aarOutput[2][NUM_ROLLOUT_OUTPUTS];
+    unsigned int n, nPlies = pdd->pes->ec.nPlies;
+    int ret = 0;
+
+    if (!nTime || pdd->pes->et != EVAL_EVAL)
+        return RunAsyncProcess((AsyncFun) asyncCubeDecision, pdd, _("Considering cube action..."));
+
+    rEvalDeadline = get_time() + nTime;
+    fEvalDeadlinePassed = FALSE;
+
+    for (n = 0; n <= nPlies; n++) {
+
+        pdd->pes->ec.nPlies = n;
+
+        if (RunAsyncProcess((AsyncFun) asyncCubeDecision, pdd, _("Considering cube action...")) != 0
+            || fInterrupt) {
+            if (n > 0 && fEvalDeadlinePassed) {
+                fInterrupt = FALSE;
+                pdd->pes->ec.nPlies = n - 1;
+                memcpy(pdd->aarOutput, aarOutput, sizeof(aarOutput));
+            } else
+                ret = -1;
+            break;
+        }
+
+        memcpy(aarOutput, pdd->aarOutput, sizeof(aarOutput));
+
+        if (get_time() >= rEvalDeadline)
+            break;
+    }
+
+    rEvalDeadline = 0.0;
+
+    return ret;
+}
+
 static int
 ComputerTurn(void)
 {
@@ -1033,6 +1126,7 @@ ComputerTurn(void)
         } else if (ms.fDoubled) {
             decisionData dd;
             cubedecision cd;
+            evalsetup esCube = ap[ms.fTurn].esCube;
 
             /* Consider cube action */
 
@@ -1069,8 +1163,8 @@ ComputerTurn(void)
             /* Evaluate cube decision */
             dd.pboard = msBoard();
             dd.pci = &ci;
-            dd.pes = &ap[ms.fTurn].esCube;
-            if (RunAsyncProcess((AsyncFun) asyncCubeDecision, &dd, _("Considering cube action...")) != 0)
+            dd.pes = &esCube;
+            if (ComputerCubeDecision(&dd, ap[ms.fTurn].nCubeTime) != 0)
                 return -1;
 
             current_pmr_cubedata_update(dd.pes, dd.aarOutput, dd.aarStdDev);
@@ -1264,12 +1358,13 @@ ComputerTurn(void)
                     /* We're in market window */
                     decisionData dd;
                     cubedecision cd;
+                    evalsetup esCube = ap[ms.fTurn].esCube;
 
                     /* Consider cube action */
                     dd.pboard = msBoard();
                     dd.pci = &ci;
-                    dd.pes = &ap[ms.fTurn].esCube;
-                    if (RunAsyncProcess((AsyncFun) asyncCubeDecision, &dd, _("Considering cube action...")) != 0)
+                    dd.pes = &esCube;
+                    if (ComputerCubeDecision(&dd, ap[ms.fTurn].nCubeTime) != 0)
                         return -1;
 
 
@@ -1310,7 +1405,7 @@ ComputerTurn(void)
                     case OPTIONAL_DOUBLE_PASS:
                     case OPTIONAL_REDOUBLE_PASS:
 
-                        if (ap[ms.fTurn].esCube.et == EVAL_EVAL && ap[ms.fTurn].esCube.ec.nPlies == 0 && arOutput[0] > 0.001f ) {
+                        if (esCube.et == EVAL_EVAL && esCube.ec.nPlies == 0 && arOutput[0] > 0.001f ) {
                             /* double if 0-ply except when about to lose game */
                             if (fTutor && fTutorCube)
                                 current_pmr_cubedata_update(dd.pes, dd.aarOutput, dd.aarStdDev);
@@ -1372,9 +1467,9 @@ ComputerTurn(void)
             fd.keyMove = NULL;
             fd.rThr = 0.0f;
             fd.pci = &ci;
-            fd.pec = &ap[ms.fTurn].esChequer.ec;
+            fd.pec = &pmr->esChequer.ec;
             fd.aamf = ap[ms.fTurn].aamf;
-            if ((RunAsyncProcess((AsyncFun) asyncFindMove, &fd, _("Considering move...")) != 0) || fInterrupt) {
+            if ((ComputerFindMove(&fd, &pmr->esChequer.ec, ap[ms.fTurn].nChequerTime) != 0) || fInterrupt) {
                 free(pmr);
                 return -1;
             }
@@ -1616,7 +1711,7 @@ static int
 TryBearoff(void)
 {
 
-    movelist ml;
+    movecandlist ml;
     unsigned int i, iMove, cMoves;
     moverecord *pmr;
 
@@ -2533,7 +2628,7 @@ CommandListMatch(char *UNUSED(sz))
  * \return 1 if found, 0 otherwise
  */
 extern int
-board_in_list(const movelist * pml, const TanBoard old_board, const TanBoard board, int *an)
+board_in_list(const movecandlist * pml, const TanBoard old_board, const TanBoard board, int *an)
 {
     guint j;
     TanBoard list_board;
@@ -2559,7 +2654,7 @@ CommandMove(char *sz)
 {
 
     int an[8];
-    movelist ml;
+    movecandlist ml;
     moverecord *pmr;
 
     if (ms.gs != GAME_PLAYING) {
@@ -3784,7 +3879,7 @@ CommandResign(char *sz)
 extern void
 CommandRoll(char *UNUSED(sz))
 {
-    movelist ml;
+    movecandlist ml;
     moverecord *pmr;
 
     if (ms.gs != GAME_PLAYING) {
@@ -62,6 +62,43 @@ PositionKey(const TanBoard anBoard, positionkey * pkey)
     anpBoard[6] = anBoard[0][24] + (anBoard[1][24] << 4);
 }
 
+uint64_t aanZobrist[25][16];
+
+extern void
+PositionHashInit(void)
+{
+    /* splitmix64 from a fixed seed, so that hashes are the same in
+     * every session */
+    uint64_t x = 0x5d3c6f1b2e4a7089ULL;
+    unsigned int i, n;
+
+    for (i = 0; i < 25; i++) {
+        aanZobrist[i][0] = 0;
+
+        for (n = 1; n < 16; n++) {
+            uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            aanZobrist[i][n] = z ^ (z >> 31);
+        }
+    }
+}
+
+extern uint64_t
+PositionHash(const TanBoard anBoard)
+{
+    uint64_t h0 = 0, h1 = 0;
+    unsigned int i;
+
+    for (i = 0; i < 25; i++) {
+        h0 ^= aanZobrist[i][anBoard[0][i]];
+        h1 ^= aanZobrist[i][anBoard[1][i]];
+    }
+
+    return h0 ^ HashSwapSides(h1);
+}
+
 extern void
 PositionFromKey(TanBoard anBoard, const positionkey * pkey)
 {
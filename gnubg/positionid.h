@@ -22,11 +22,26 @@
 #ifndef POSITIONID_H
 #define POSITIONID_H
 
+#include <stdint.h>
+
 #include "gnubg-types.h"
 
 #define L_POSITIONID 14
 
 extern void PositionKey(const TanBoard anBoard, positionkey * pkey);
+
+/* 64 bit Zobrist hash of a position: the xor of aanZobrist[i][n] over
+ * the points i of side 0 with n chequers, and of the same values
+ * rotated by 32 bits for side 1.  Moving a chequer changes it by a
+ * few xors, and the hash of the position with the sides swapped is
+ * the hash rotated by 32 bits.  aanZobrist[i][0] is 0. */
+extern uint64_t aanZobrist[25][16];
+
+#define HashSwapSides(h) (((h) << 32) | ((h) >> 32))
+#define ZobristPoint(side, i, n) ((side) ? HashSwapSides(aanZobrist[i][n]) : aanZobrist[i][n])
+
+extern void PositionHashInit(void);
+extern uint64_t PositionHash(const TanBoard anBoard);
 extern char *PositionID(const TanBoard anBoard);
 extern char *PositionIDFromKey(const positionkey * pkey);
 
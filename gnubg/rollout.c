@@ -39,7 +39,12 @@
 #include "positionid.h"
 #include "format.h"
 #include "multithread.h"
+#include "progress.h"
 #include "rollout.h"
+#if defined(WEB)
+#include <emscripten.h>
+#include "matchequity.h"
+#endif
 
 #if !LOCKING_VERSION
 
@@ -48,8 +53,19 @@ f_BasicCubefulRollout BasicCubefulRollout = BasicCubefulRolloutNoLocking;
 
 int log_rollouts = 0;
 char *log_file_name = 0;
+/* the file rollouts write their checkpoints to, if not the default */
+char *szRolloutCheckpoint = NULL;
 static unsigned int initial_game_count;
 
+#if USE_MULTITHREAD
+/* number of trials of each alternative a thread plays before it merges
+ * its results and checks the stopping rules.  A merge holds the lock for
+ * a few microseconds against milliseconds for a trial, so merging every
+ * trial costs nothing measurable, while larger intervals let the threads
+ * play up to that many trials per thread past a JSD or SD stop. */
+unsigned int nRolloutMergeInterval = 1;
+#endif
+
 /* make sgf files of rollouts if log_rollouts is true and we have a file 
  * name template to work with
  */
@@ -204,10 +220,27 @@ QuasiRandomSeed(perArray * pArray, int n)
             }
         }
 
+    for (k = 0, i = 0; k < 36; k++)
+        if (pArray->aaanPermutation[0][0][k] / 6 != pArray->aaanPermutation[0][0][k] % 6)
+            pArray->anNonDouble[i++] = k;
+
     pArray->nPermutationSeed = n;
 }
 
-static int nSkip;
+/* The quasi-random rolls trial iGame plays.  Rollouts of the initial
+ * position cannot start with a double, so their trial iGame takes the
+ * iGame'th roll other than a double in the permutation of the first roll
+ * instead, and the later rolls follow on from there.  This depends on
+ * the trial alone, so it comes out the same whichever thread plays it. */
+
+static unsigned int
+QuasiRandomTrial(const perArray * dicePerms, int iGame, int fInitial)
+{
+    if (!fInitial)
+        return (unsigned int) iGame;
+
+    return (unsigned int) iGame / 30 * 36 + dicePerms->anNonDouble[iGame % 30];
+}
 
 extern int
 RolloutDice(int iTurn, int iGame,
@@ -218,20 +251,10 @@ RolloutDice(int iTurn, int iGame,
     if (fInitial && !iTurn) {
         /* rollout of initial position: no doubles allowed */
         if (fRotate) {
-            unsigned int j;
-
-            if (!iGame)
-                nSkip = 0;
-
-            for (;; nSkip++) {
-                j = dicePerms->aaanPermutation[0][0][(iGame + nSkip) % 36];
+            unsigned int j = dicePerms->aaanPermutation[0][0][QuasiRandomTrial(dicePerms, iGame, TRUE) % 36];
 
-                anDice[0] = j / 6 + 1;
-                anDice[1] = j % 6 + 1;
-
-                if (anDice[0] != anDice[1])
-                    break;
-            }
+            anDice[0] = j / 6 + 1;
+            anDice[1] = j % 6 + 1;
 
             return 0;
         } else {
@@ -247,9 +270,10 @@ RolloutDice(int iTurn, int iGame,
         unsigned int i,         /* the "generation" of the permutation */
          j,                     /* the number we're permuting */
          k;                     /* 36**i */
+        unsigned int n = QuasiRandomTrial(dicePerms, iGame, fInitial);
 
         for (i = 0, j = 0, k = 1; i < 6 && i <= (unsigned int) iTurn; i++, k *= 36)
-            j = dicePerms->aaanPermutation[i][iTurn][((iGame + nSkip) / k + j) % 36];
+            j = dicePerms->aaanPermutation[i][iTurn][(n / k + j) % 36];
 
         anDice[0] = j / 6 + 1;
         anDice[1] = j % 6 + 1;
@@ -316,7 +340,7 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
                     const cubeinfo aci[], int afCubeDecTop[], unsigned int cci,
                     rolloutcontext * prc,
                     rolloutstat aarsStatistics[][2],
-                    int nBasisCube, perArray * dicePerms, rngcontext * rngctxRollout, FILE * logfp)
+                    int nBasisCube, const perArray * dicePerms, rngcontext * rngctxRollout, FILE * logfp)
 {
 
     unsigned int anDice[2];
@@ -925,6 +949,62 @@ static int ro_NextTrial;
 static unsigned int *altGameCount;
 static int *altTrialCount;
 
+/* The quasi-random permutations of the alternatives that use them.  They
+ * are computed once per seed before the trials start, and the threads
+ * and pool workers that play the trials only read them. */
+static const perArray **ro_apDicePerms;
+
+static void
+RolloutDicePermsStart(void)
+{
+    int alt, alt2;
+
+    ro_apDicePerms = g_new0(const perArray *, ro_alternatives);
+
+    for (alt = 0; alt < ro_alternatives; alt++) {
+        const rolloutcontext *prc = &ro_apes[alt]->rc;
+        perArray *pPerms;
+
+        if (!prc->fRotate)
+            continue;
+
+        for (alt2 = 0; alt2 < alt; alt2++)
+            if (ro_apDicePerms[alt2] && ro_apDicePerms[alt2]->nPermutationSeed == (int) prc->nSeed)
+                break;
+
+        if (alt2 < alt) {
+            ro_apDicePerms[alt] = ro_apDicePerms[alt2];
+            continue;
+        }
+
+        pPerms = g_new(perArray, 1);
+        pPerms->nPermutationSeed = -1;
+        QuasiRandomSeed(pPerms, (int) prc->nSeed);
+        ro_apDicePerms[alt] = pPerms;
+    }
+}
+
+static void
+RolloutDicePermsFinish(void)
+{
+    int alt, alt2;
+
+    if (!ro_apDicePerms)
+        return;
+
+    /* alternatives with the same seed share their permutations */
+    for (alt = 0; alt < ro_alternatives; alt++) {
+        for (alt2 = 0; alt2 < alt; alt2++)
+            if (ro_apDicePerms[alt2] == ro_apDicePerms[alt])
+                break;
+        if (alt2 == alt)
+            g_free((perArray *) ro_apDicePerms[alt]);
+    }
+
+    g_free(ro_apDicePerms);
+    ro_apDicePerms = NULL;
+}
+
 static void
 check_jsds(int *active)
 {
@@ -1106,110 +1186,516 @@ check_sds(int *active)
 
 }
 
-extern void
-RolloutLoopMT(void *UNUSED(unused))
+/* Plays trial number trial of alternative alt, leaving its result in
+ * aar and its statistics, if any, in prs */
+
+static void
+RolloutTrial(int alt, int trial, float aar[NUM_ROLLOUT_OUTPUTS], rolloutstat(*prs)[2], rngcontext * rngctx)
 {
     TanBoard anBoardEval;
-    float aar[NUM_ROLLOUT_OUTPUTS];
-    int active_alternatives;
+    FILE *logfp = NULL;
+    rolloutcontext *prc = &ro_apes[alt]->rc;
+
+    /* get the RNG set up; the quasi-random dice are in ro_apDicePerms */
+    if (prc->rngRollout != RNG_MANUAL)
+        InitRNGSeed((unsigned int) (prc->nSeed + (trial << 8)), prc->rngRollout, rngctx);
+
+    memcpy(&anBoardEval, ro_apBoard[alt], sizeof(anBoardEval));
+
+    /* roll something out */
+    if (log_rollouts && log_file_name) {
+        char *log_name = g_strdup_printf("%s-%7.7d-%c.sgf", log_file_name, trial, alt + 'a');
+        logfp = log_game_start(log_name, ro_apci[alt], prc->fCubeful, anBoardEval);
+        g_free(log_name);
+    }
+    BasicCubefulRollout(&anBoardEval, (float (*)[NUM_ROLLOUT_OUTPUTS]) aar, 0, trial, ro_apci[alt],
+                        ro_apCubeDecTop[alt], 1, prc, prs,
+                        aciLocal[ro_fCubeRollout ? 0 : alt].nCube, ro_apDicePerms[alt], rngctx, logfp);
+
+    if (logfp) {
+        log_game_over(logfp);
+    }
+}
+
+#if !USE_MULTITHREAD
+
+/* Adds the result of a trial of alternative alt to the running means
+ * and variances.  Called with the exclusive lock held. */
+
+static void
+RolloutAddResult(int alt, float aar[NUM_ROLLOUT_OUTPUTS])
+{
     unsigned int j;
+    rolloutcontext *prc = &ro_apes[alt]->rc;
+
+    altGameCount[alt]++;
+
+    if (ro_fInvert)
+        InvertEvaluationR(aar, ro_apci[alt]);
+
+    /* apply the results */
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        float rMuNew, rDelta;
+
+        aarResult[alt][j] += aar[j];
+        rMuNew = aarResult[alt][j] / (altGameCount[alt]);
+
+        if (altGameCount[alt] > 1) {    /* for i == 0 aarVariance is not defined */
+
+            rDelta = rMuNew - aarMu[alt][j];
+
+            aarVariance[alt][j] =
+                aarVariance[alt][j] * (1.0f - 1.0f / (altGameCount[alt] - 1)) +
+                (altGameCount[alt]) * rDelta * rDelta;
+        }
+
+        aarMu[alt][j] = rMuNew;
+
+        if (j < OUTPUT_EQUITY) {
+            if (aarMu[alt][j] < 0.0f)
+                aarMu[alt][j] = 0.0f;
+            else if (aarMu[alt][j] > 1.0f)
+                aarMu[alt][j] = 1.0f;
+        }
+
+        aarSigma[alt][j] = sqrtf(aarVariance[alt][j] / (altGameCount[alt]));
+    }                           /* for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++ ) */
+
+    /* For normal alternatives nGamesDone and altGameCount will be equal. For cube decisions,
+     * however, the two may differ by the number of threads minus 1. So we cheat a little bit, but
+     * it would be better if the double and nodouble alternatives weren't linked */
+    if (prc->nGamesDone < altGameCount[alt])
+        prc->nGamesDone = altGameCount[alt];
+}
+
+#else
+
+/*
+ * Each thread keeps the results of its trials to itself, as counts,
+ * means and sums of squared deviations (Welford), and only every
+ * nRolloutMergeInterval rounds takes the exclusive lock to merge them
+ * into the totals (the pairwise update of Chan, Golub and LeVeque) and
+ * check the stopping rules for everybody.
+ */
+
+typedef struct {
+    unsigned int n;
+    double arMean[NUM_ROLLOUT_OUTPUTS];
+    double arM2[NUM_ROLLOUT_OUTPUTS];
+} rolloutacc;
+
+static void
+RolloutAccumulate(rolloutacc * pacc, int alt, float aar[NUM_ROLLOUT_OUTPUTS])
+{
+    unsigned int j;
+
+    if (ro_fInvert)
+        InvertEvaluationR(aar, ro_apci[alt]);
+
+    pacc->n++;
+
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        double rDelta = aar[j] - pacc->arMean[j];
+
+        pacc->arMean[j] += rDelta / pacc->n;
+        pacc->arM2[j] += rDelta * (aar[j] - pacc->arMean[j]);
+    }
+}
+
+/* Merges the results a thread has gathered for alternative alt into the
+ * running means and variances, and empties pacc.  Called with the
+ * exclusive lock held. */
+
+static void
+RolloutMergeResult(int alt, rolloutacc * pacc)
+{
+    unsigned int j;
+    unsigned int nA = altGameCount[alt];
+    unsigned int n = nA + pacc->n;
+    rolloutcontext *prc = &ro_apes[alt]->rc;
+
+    if (!pacc->n)
+        return;
+
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        /* aarVariance holds the sample variance of the nA games so far */
+        double rMeanA = nA ? aarResult[alt][j] / nA : 0.0;
+        double rM2A = nA > 1 ? (double) aarVariance[alt][j] * (nA - 1) : 0.0;
+        double rDelta = pacc->arMean[j] - rMeanA;
+        double rM2 = rM2A + pacc->arM2[j] + rDelta * rDelta * nA * pacc->n / n;
+
+        aarResult[alt][j] += (float) (pacc->arMean[j] * pacc->n);
+        aarMu[alt][j] = aarResult[alt][j] / n;
+
+        if (j < OUTPUT_EQUITY) {
+            if (aarMu[alt][j] < 0.0f)
+                aarMu[alt][j] = 0.0f;
+            else if (aarMu[alt][j] > 1.0f)
+                aarMu[alt][j] = 1.0f;
+        }
+
+        aarVariance[alt][j] = n > 1 ? (float) (rM2 / (n - 1)) : 0.0f;
+        aarSigma[alt][j] = sqrtf(aarVariance[alt][j] / n);
+    }
+
+    altGameCount[alt] = n;
+
+    /* For normal alternatives nGamesDone and altGameCount will be equal. For cube decisions,
+     * however, the two may differ by what the threads have not merged yet */
+    if (prc->nGamesDone < altGameCount[alt])
+        prc->nGamesDone = altGameCount[alt];
+
+    memset(pacc, 0, sizeof(rolloutacc));
+}
+
+#endif                          /* !USE_MULTITHREAD */
+
+#if defined(WEB)
+
+/*
+ * Rollouts on a pool of Web Workers.
+ *
+ * The web build has no threads, so the page may instead start a pool of
+ * workers (rolloutpool.js), each running its own engine.  A rollout is
+ * cut into units, unit u being trial nFirst + u / alternatives of
+ * alternative u % alternatives.  The workers claim units in order and
+ * hand back their results in a SharedArrayBuffer; RolloutLoopMT() takes
+ * them up in exactly the order it would have played them itself, so
+ * the rollout comes out the same as without the pool.  While a unit is
+ * not back yet, the page plays the next unclaimed one itself; units of
+ * alternatives that were stopped and resumed are always played here.
+ */
+
+/* the layout of a job, as handed to the workers */
+typedef struct {
+    int alternatives;
+    int cGames;
+    int fCubeRollout;
+    int fStatistics;
+} rolloutpoolhead;
+
+typedef struct {
+    TanBoard anBoard;
+    cubeinfo ci;
+    cubeinfo ciLocal;
+    int fCubeDecTop;
+    int nFirst;                 /* trial of unit alt */
+    evalsetup es;
+} rolloutpoolalt;
+
+static struct {
+    int nLow;                   /* first unit of the current round */
+    int *anFirst;
+    int fStatistics;
+    rngcontext *rngctx;
+    /* the job as installed in a worker */
+    rolloutpoolalt *arpa;
+    evalsetup **apes;
+    ConstTanBoard *apBoard;
+    const cubeinfo **apci;
+    int **apCubeDecTop;
+    cubeinfo *aciLocal;
+    int *afNoMore;
+} rp;
+
+static void
+AddRolloutstat(rolloutstat * prs, const rolloutstat * prsAdd)
+{
+    int *pn = (int *) prs;
+    const int *pnAdd = (const int *) prsAdd;
+    unsigned int i;
+
+    /* rolloutstat is all counters */
+    for (i = 0; i < sizeof(rolloutstat) / sizeof(int); i++)
+        pn[i] += pnAdd[i];
+}
+
+/* Plays unit u of the current job into aar and ars (if the job keeps
+ * statistics).  Returns FALSE if there is no such trial to play. */
+
+int
+EMSCRIPTEN_KEEPALIVE
+rollout_pool_play(int u, float *aar, rolloutstat * ars)
+{
+    int alt = u % ro_alternatives;
+    int trial = rp.anFirst[alt] + u / ro_alternatives;
+
+    if (trial > cGames || fNoMore[alt])
+        return FALSE;
+
+    if (rp.fStatistics) {
+        initRolloutstat(&ars[0]);
+        initRolloutstat(&ars[1]);
+    }
+
+    RolloutTrial(alt, trial, aar, rp.fStatistics ? (rolloutstat(*)[2]) ars : NULL, rp.rngctx);
+
+    return TRUE;
+}
+
+/* Installs a job from the page in a worker */
+
+void
+EMSCRIPTEN_KEEPALIVE
+rollout_pool_job(const unsigned char *pch)
+{
+    rolloutpoolhead rph;
     int alt;
-    FILE *logfp = NULL;
-    rolloutcontext *prc = NULL;
-    /* Each thread gets a copy of the rngctxRollout */
-    rngcontext *rngctxMTRollout = CopyRNGContext(rngctxRollout);
-    perArray dicePerms;
-    dicePerms.nPermutationSeed = -1;
 
-    /* ============ begin rollout loop ============= */
+    memcpy(&rph, pch, sizeof(rph));
+
+    /* the permutations of the last job */
+    RolloutDicePermsFinish();
+
+    g_free(rp.arpa);
+    g_free(rp.anFirst);
+    g_free(rp.apes);
+    g_free(rp.apBoard);
+    g_free(rp.apci);
+    g_free(rp.apCubeDecTop);
+    g_free(rp.aciLocal);
+    g_free(rp.afNoMore);
+
+    rp.arpa = g_memdup(pch + sizeof(rph), rph.alternatives * sizeof(rolloutpoolalt));
+    rp.anFirst = g_new(int, rph.alternatives);
+    rp.apes = g_new(evalsetup *, rph.alternatives);
+    rp.apBoard = g_new(ConstTanBoard, rph.alternatives);
+    rp.apci = g_new(const cubeinfo *, rph.alternatives);
+    rp.apCubeDecTop = g_new(int *, rph.alternatives);
+    rp.aciLocal = g_new(cubeinfo, rph.alternatives);
+    /* stopped alternatives are skipped by the page */
+    rp.afNoMore = g_new0(int, rph.alternatives);
+
+    for (alt = 0; alt < rph.alternatives; alt++) {
+        rolloutpoolalt *prpa = &rp.arpa[alt];
+
+        rp.anFirst[alt] = prpa->nFirst;
+        rp.apes[alt] = &prpa->es;
+        rp.apBoard[alt] = (ConstTanBoard) prpa->anBoard;
+        rp.apci[alt] = &prpa->ci;
+        rp.apCubeDecTop[alt] = &prpa->fCubeDecTop;
+        rp.aciLocal[alt] = prpa->ciLocal;
+    }
 
-    while (MT_SafeIncValue(&ro_NextTrial) <= cGames) {
-        active_alternatives = ro_alternatives;
+    ro_alternatives = rph.alternatives;
+    cGames = rph.cGames;
+    ro_fCubeRollout = rph.fCubeRollout;
+    rp.fStatistics = rph.fStatistics;
+    ro_apes = rp.apes;
+    ro_apBoard = rp.apBoard;
+    ro_apci = rp.apci;
+    ro_apCubeDecTop = rp.apCubeDecTop;
+    aciLocal = rp.aciLocal;
+    fNoMore = rp.afNoMore;
+
+    if (!rp.rngctx)
+        rp.rngctx = CopyRNGContext(rngctxRollout);
+    RolloutDicePermsStart();
+}
 
-        for (alt = 0; alt < ro_alternatives; ++alt) {
-            int trial = MT_SafeIncValue(&altTrialCount[alt]) - 1;
-            /* skip this one if it's already finished */
-            if (fNoMore[alt] || (trial > cGames)) {
-                MT_SafeDec(&altTrialCount[alt]);
-                continue;
-            }
+/* Hands the current rollout to the pool, if there is one and the
+ * rollout can be played anywhere.  Returns TRUE if it did. */
 
+static int
+RolloutPoolStart(void)
+{
+    unsigned char *pch;
+    rolloutpoolhead rph;
+    size_t cb;
+    char *szSettings;
+    int alt;
 
-            prc = &ro_apes[alt]->rc;
+    if (!EM_ASM_INT({ return typeof RolloutPoolSize !== 'undefined' ? RolloutPoolSize() : 0; }))
+        return FALSE;
+
+    /* logged rollouts are written by this engine, and the other
+     * generators are not a function of the seed alone */
+    if (log_rollouts)
+        return FALSE;
+
+    for (alt = 0; alt < ro_alternatives; alt++)
+        switch (ro_apes[alt]->rc.rngRollout) {
+        case RNG_ANSI:
+        case RNG_BSD:
+        case RNG_ISAAC:
+        case RNG_MD5:
+        case RNG_MERSENNE:
+            break;
+        default:
+            return FALSE;
+        }
+
+    rph.alternatives = ro_alternatives;
+    rph.cGames = cGames;
+    rph.fCubeRollout = ro_fCubeRollout;
+    rph.fStatistics = ro_aarsStatistics != NULL;
+
+    cb = sizeof(rph) + ro_alternatives * sizeof(rolloutpoolalt);
+    pch = g_malloc0(cb);
+    memcpy(pch, &rph, sizeof(rph));
+
+    rp.anFirst = g_new(int, ro_alternatives);
+    for (alt = 0; alt < ro_alternatives; alt++) {
+        rolloutpoolalt *prpa = (rolloutpoolalt *) (pch + sizeof(rph)) + alt;
+
+        memcpy(prpa->anBoard, ro_apBoard[alt], sizeof(TanBoard));
+        prpa->ci = *ro_apci[alt];
+        prpa->ciLocal = aciLocal[alt];
+        prpa->fCubeDecTop = ro_apCubeDecTop[alt][0];
+        prpa->nFirst = rp.anFirst[alt] = altTrialCount[alt];
+        prpa->es = *ro_apes[alt];
+    }
 
-            /* get the dice generator set up... */
-            if (prc->fRotate)
-                QuasiRandomSeed(&dicePerms, (int) prc->nSeed);
+    /* the engine settings the trials depend on */
+    szSettings = g_strdup_printf("set eval quantized %s\n"
+                                 "set eval bitboardmoves %s\n"
+                                 "set eval progressive %s\n"
+                                 "set matchequitytable \"%s\"\n"
+                                 "set invert matchequitytable %s\n",
+                                 fEvalQuantized ? "on" : "off",
+                                 fMoveGenBits ? "on" : "off",
+                                 fEvalProgressive ? "on" : "off",
+                                 miCurrent.szFileName, fInvertMET ? "on" : "off");
+
+    EM_ASM({
+           rolloutPool.start(HEAPU8.slice($0, $0 + $1), UTF8ToString($2), $3, $4, $5, $6);
+           }, pch, cb, szSettings, ro_alternatives * (cGames - ro_NextTrial), ro_alternatives,
+           NUM_ROLLOUT_OUTPUTS, ro_aarsStatistics ? (int) (2 * sizeof(rolloutstat) / sizeof(int)) : 0);
+
+    g_free(szSettings);
+    g_free(pch);
+
+    if (!rp.rngctx)
+        rp.rngctx = CopyRNGContext(rngctxRollout);
+    rp.fStatistics = rph.fStatistics;
+    rp.nLow = 0;
 
-            nSkip = 0;          /* not multi-thread safe do quasi random dice for initial positions */
+    return TRUE;
+}
 
-            /* ... and the RNG */
-            if (prc->rngRollout != RNG_MANUAL)
-                InitRNGSeed((unsigned int) (prc->nSeed + (trial << 8)), prc->rngRollout, rngctxMTRollout);
+/* The result of trial number trial of alternative alt, from the pool if
+ * a worker played it */
 
-            memcpy(&anBoardEval, ro_apBoard[alt], sizeof(anBoardEval));
+static void
+RolloutPoolTrial(int alt, int trial, float aar[NUM_ROLLOUT_OUTPUTS], rngcontext * rngctx)
+{
+    int u = (trial - rp.anFirst[alt]) * ro_alternatives + alt;
+    rolloutstat(*prs)[2] = ro_aarsStatistics ? ro_aarsStatistics + alt : NULL;
+    rolloutstat ars[2];
+    float arOther[NUM_ROLLOUT_OUTPUTS];
+    rolloutstat arsOther[2];
+
+    /* units behind the current round belong to resumed alternatives;
+     * their slots may already hold later units */
+    if (u >= rp.nLow)
+        for (;;) {
+            int n = EM_ASM_INT({ return rolloutPool.take($0, HEAPU8.buffer, $1, $2); }, u, aar, ars);
+            int v;
+
+            if (n > 0) {
+                /* played by a worker */
+                if (prs) {
+                    AddRolloutstat(&(*prs)[0], &ars[0]);
+                    AddRolloutstat(&(*prs)[1], &ars[1]);
+                }
+                return;
+            } else if (n < 0)
+                /* skipped by a worker */
+                break;
 
-            /* roll something out */
-            if (log_rollouts && log_file_name) {
-                char *log_name = g_strdup_printf("%s-%7.7d-%c.sgf", log_file_name, trial, alt + 'a');
-                logfp = log_game_start(log_name, ro_apci[alt], prc->fCubeful, anBoardEval);
-                g_free(log_name);
-            }
-            BasicCubefulRollout(&anBoardEval, &aar, 0, trial, ro_apci[alt],
-                                ro_apCubeDecTop[alt], 1, prc,
-                                ro_aarsStatistics ? ro_aarsStatistics + alt : NULL,
-                                aciLocal[ro_fCubeRollout ? 0 : alt].nCube, &dicePerms, rngctxMTRollout, logfp);
+            /* not back yet; play the next unclaimed unit meanwhile,
+             * which may be this one */
+            if ((v = EM_ASM_INT({ return rolloutPool.claim($0); }, u)) >= 0) {
+                int fPlayed = rollout_pool_play(v, arOther, arsOther);
 
-            if (logfp) {
-                log_game_over(logfp);
+                EM_ASM({ rolloutPool.put($0, HEAPU8.buffer, $1, $2, $3); }, v, arOther, arsOther, fPlayed);
             }
+        }
 
-            if (fInterrupt)
-                break;
+    RolloutTrial(alt, trial, aar, prs, rngctx);
+}
 
-            multi_debug("exclusive lock: update result for alternative");
-            MT_Exclusive();
-            altGameCount[alt]++;
+static void
+RolloutPoolRound(int iRound)
+{
+    rp.nLow = iRound * ro_alternatives;
+    EM_ASM({ rolloutPool.advance($0); }, rp.nLow);
+}
 
-            if (ro_fInvert)
-                InvertEvaluationR(aar, ro_apci[alt]);
+static void
+RolloutPoolStopped(void)
+{
+    int alt;
 
-            /* apply the results */
-            for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
-                float rMuNew, rDelta;
+    for (alt = 0; alt < ro_alternatives; alt++)
+        EM_ASM({ rolloutPool.stopped($0, $1); }, alt, fNoMore[alt]);
+}
 
-                aarResult[alt][j] += aar[j];
-                rMuNew = aarResult[alt][j] / (altGameCount[alt]);
+static void
+RolloutPoolFinish(void)
+{
+    EM_ASM({ rolloutPool.finish(); });
 
-                if (altGameCount[alt] > 1) {    /* for i == 0 aarVariance is not defined */
+    g_free(rp.anFirst);
+    rp.anFirst = NULL;
+}
 
-                    rDelta = rMuNew - aarMu[alt][j];
+#endif                          /* WEB */
 
-                    aarVariance[alt][j] =
-                        aarVariance[alt][j] * (1.0f - 1.0f / (altGameCount[alt] - 1)) +
-                        (altGameCount[alt]) * rDelta * rDelta;
-                }
+extern void
+RolloutLoopMT(void *UNUSED(unused))
+{
+    float aar[NUM_ROLLOUT_OUTPUTS];
+    int active_alternatives;
+    int alt;
+    /* Each thread gets a copy of the rngctxRollout */
+    rngcontext *rngctxMTRollout = CopyRNGContext(rngctxRollout);
+#if defined(WEB)
+    int fPool = RolloutPoolStart();
+    int iRound = 0;
+#endif
+#if USE_MULTITHREAD
+    rolloutacc *aacc = g_new0(rolloutacc, ro_alternatives);
+    unsigned int cRounds = 0;
+#endif
 
-                aarMu[alt][j] = rMuNew;
+    /* ============ begin rollout loop ============= */
 
-                if (j < OUTPUT_EQUITY) {
-                    if (aarMu[alt][j] < 0.0f)
-                        aarMu[alt][j] = 0.0f;
-                    else if (aarMu[alt][j] > 1.0f)
-                        aarMu[alt][j] = 1.0f;
-                }
+    while (MT_SafeIncValue(&ro_NextTrial) <= cGames) {
+        active_alternatives = ro_alternatives;
+
+#if defined(WEB)
+        if (fPool)
+            RolloutPoolRound(iRound++);
+#endif
+
+        for (alt = 0; alt < ro_alternatives; ++alt) {
+            int trial = MT_SafeIncValue(&altTrialCount[alt]) - 1;
+            /* skip this one if it's already finished */
+            if (fNoMore[alt] || (trial > cGames)) {
+                MT_SafeDec(&altTrialCount[alt]);
+                continue;
+            }
 
-                aarSigma[alt][j] = sqrtf(aarVariance[alt][j] / (altGameCount[alt]));
-            }                   /* for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++ ) */
+#if defined(WEB)
+            if (fPool)
+                RolloutPoolTrial(alt, trial, aar, rngctxMTRollout);
+            else
+#endif
+                RolloutTrial(alt, trial, aar, ro_aarsStatistics ? ro_aarsStatistics + alt : NULL, rngctxMTRollout);
 
-            /* For normal alternatives nGamesDone and altGameCount will be equal. For cube decisions,
-             * however, the two may differ by the number of threads minus 1. So we cheat a little bit, but
-             * it would be better if the double and nodouble alternatives weren't linked */
-            if (prc->nGamesDone < altGameCount[alt])
-                prc->nGamesDone = altGameCount[alt];
+            if (fInterrupt)
+                break;
 
+#if USE_MULTITHREAD
+            RolloutAccumulate(&aacc[alt], alt, aar);
+#else
+            multi_debug("exclusive lock: update result for alternative");
+            MT_Exclusive();
+            RolloutAddResult(alt, aar);
             MT_Release();
             multi_debug("exclusive release: update result for alternative");
+#endif
 
         }                       /* for (alt = 0; alt < ro_alternatives; ++alt) */
 
@@ -1220,18 +1706,30 @@ RolloutLoopMT(void *UNUSED(unused))
         /* Stop rolling out moves whose Equity is more than a user selected multiple of the joint standard
          * deviation of the equity difference with the best move in the list. */
 
-#if !USE_MULTITHREAD
+#if USE_MULTITHREAD
+        if (++cRounds < nRolloutMergeInterval)
+            continue;
+        cRounds = 0;
+#else
         ProcessEvents();
 #endif
 
         multi_debug("exclusive lock: rollout cycle update");
         MT_Exclusive();
+#if USE_MULTITHREAD
+        for (alt = 0; alt < ro_alternatives; ++alt)
+            RolloutMergeResult(alt, &aacc[alt]);
+#endif
         if (show_jsds) {
             check_jsds(&active_alternatives);
         }
         if (rcRollout.fStopOnSTD) {
             check_sds(&active_alternatives);
         }
+#if defined(WEB)
+        if (fPool)
+            RolloutPoolStopped();
+#endif
         if ((active_alternatives < 2 && rcRollout.fStopOnJsd) || active_alternatives < 1) {
             multi_debug("exclusive release: rollout done early");
             MT_Release();
@@ -1240,9 +1738,178 @@ RolloutLoopMT(void *UNUSED(unused))
         multi_debug("exclusive release: rollout cycle update");
         MT_Release();
     }
+#if USE_MULTITHREAD
+    /* hand in the trials played since the last merge */
+    multi_debug("exclusive lock: rollout final merge");
+    MT_Exclusive();
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        RolloutMergeResult(alt, &aacc[alt]);
+    if (cRounds && !fInterrupt) {
+        active_alternatives = ro_alternatives;
+        if (show_jsds)
+            check_jsds(&active_alternatives);
+        if (rcRollout.fStopOnSTD)
+            check_sds(&active_alternatives);
+    }
+    MT_Release();
+    multi_debug("exclusive release: rollout final merge");
+    g_free(aacc);
+#endif
+#if defined(WEB)
+    if (fPool)
+        RolloutPoolFinish();
+#endif
     free(rngctxMTRollout);
 }
 
+/*
+ * Rollout checkpoints.
+ *
+ * With "set autosave checkpoint" on, a rollout writes what it has done
+ * so far to a checkpoint file every nAutoSaveTime minutes, and once more
+ * when it ends, finished or not: the rollout settings it was started
+ * with and, for each alternative, its position, cube and settings, the
+ * games played, the sums behind the means and variances and the
+ * statistics.  Every trial seeds the dice from the seed and the trial
+ * number alone, so that is all the dice need to go on as before.
+ * "rollout resume" hands a checkpoint back to RolloutGeneral() as
+ * previous rollouts to extend.  Like cache snapshots, checkpoints are in
+ * the byte order of the machine that wrote them.
+ */
+
+#define ROLLOUT_CHECKPOINT_MAGIC "GNUBGRC"
+#define ROLLOUT_CHECKPOINT_VERSION 1
+#define ROLLOUT_CHECKPOINT_BYTEORDER 0x01020304
+
+typedef struct {
+    char szMagic[8];
+    uint32_t nVersion;
+    uint32_t nByteOrder;
+    uint32_t cbAlt;             /* sizeof(rolloutcheckpointalt) */
+    int alternatives;
+    int fInvert;
+    int fCubeRollout;
+    int fStatistics;
+    rolloutcontext rc;          /* rcRollout as the rollout was started */
+} rolloutcheckpointhead;
+
+typedef struct {
+    TanBoard anBoard;
+    cubeinfo ci;
+    int fCubeDecTop;
+    evalsetup es;
+    float arResult[NUM_ROLLOUT_OUTPUTS];
+    float arVariance[NUM_ROLLOUT_OUTPUTS];
+    float arMu[NUM_ROLLOUT_OUTPUTS];
+    float arSigma[NUM_ROLLOUT_OUTPUTS];
+    rolloutstat ars[2];
+} rolloutcheckpointalt;
+
+static const rolloutcontext *ro_prcStart;
+static char *ro_szCheckpoint;   /* where checkpoints go, or NULL */
+static gint64 ro_tCheckpoint;   /* when the next one is due */
+static const char *ro_szResume;
+static const rolloutcheckpointalt *ro_arcaResume;
+
+/* The file rollouts write their checkpoints to, to be freed by the
+ * caller */
+
+extern char *
+RolloutCheckpointFile(void)
+{
+    if (szRolloutCheckpoint)
+        return g_strdup(szRolloutCheckpoint);
+
+#if defined(WEB)
+    /* kept in IndexedDB by gnubg_web.html */
+    return g_strdup("/cache/rollout.ckp");
+#else
+    return g_build_filename(szHomeDirectory, "rollout.ckp", NULL);
+#endif
+}
+
+static void
+RolloutCheckpointDue(void)
+{
+    ro_tCheckpoint = g_get_monotonic_time() + (gint64) nAutoSaveTime * 60 * G_USEC_PER_SEC;
+}
+
+/* Writes a checkpoint of the current rollout to ro_szCheckpoint.  Called
+ * with the exclusive lock held, or with the threads done. */
+
+static void
+RolloutCheckpoint(void)
+{
+    rolloutcheckpointhead h;
+    rolloutcheckpointalt *arca;
+    char *szTemp;
+    FILE *pf;
+    int alt;
+
+    memset(&h, 0, sizeof(h));
+    strcpy(h.szMagic, ROLLOUT_CHECKPOINT_MAGIC);
+    h.nVersion = ROLLOUT_CHECKPOINT_VERSION;
+    h.nByteOrder = ROLLOUT_CHECKPOINT_BYTEORDER;
+    h.cbAlt = sizeof(rolloutcheckpointalt);
+    h.alternatives = ro_alternatives;
+    h.fInvert = ro_fInvert;
+    h.fCubeRollout = ro_fCubeRollout;
+    h.fStatistics = ro_aarsStatistics != NULL;
+    h.rc = *ro_prcStart;
+
+    arca = g_new0(rolloutcheckpointalt, ro_alternatives);
+    for (alt = 0; alt < ro_alternatives; alt++) {
+        rolloutcheckpointalt *prca = &arca[alt];
+
+        memcpy(prca->anBoard, ro_apBoard[alt], sizeof(TanBoard));
+        prca->ci = *ro_apci[alt];
+        prca->fCubeDecTop = ro_apCubeDecTop[alt][0];
+        prca->es = *ro_apes[alt];
+        /* the context a cube decision shares may be ahead of this
+         * alternative */
+        prca->es.rc.nGamesDone = altGameCount[alt];
+        memcpy(prca->arResult, aarResult[alt], sizeof(prca->arResult));
+        memcpy(prca->arVariance, aarVariance[alt], sizeof(prca->arVariance));
+        memcpy(prca->arMu, aarMu[alt], sizeof(prca->arMu));
+        memcpy(prca->arSigma, aarSigma[alt], sizeof(prca->arSigma));
+        if (ro_aarsStatistics)
+            memcpy(prca->ars, ro_aarsStatistics[alt], sizeof(prca->ars));
+    }
+
+    /* the new checkpoint only replaces the old one once it is complete */
+    szTemp = g_strconcat(ro_szCheckpoint, ".tmp", NULL);
+
+    if (!(pf = g_fopen(szTemp, "wb")))
+        outputerr(szTemp);
+    else if (fwrite(&h, sizeof(h), 1, pf) != 1
+             || fwrite(arca, sizeof(*arca), ro_alternatives, pf) != (size_t) ro_alternatives) {
+        outputerr(szTemp);
+        fclose(pf);
+        g_unlink(szTemp);
+    } else {
+        fclose(pf);
+#ifdef WIN32
+        g_unlink(ro_szCheckpoint);
+#endif
+        if (g_rename(szTemp, ro_szCheckpoint) != 0)
+            outputerr(ro_szCheckpoint);
+    }
+
+#if defined(WEB)
+    /* FS.syncfs() would wait for the rollout to end; gnubg_web.html has
+     * a worker write the checkpoint to IndexedDB now */
+    EM_ASM({
+           if (typeof CheckpointWrite !== 'undefined')
+               CheckpointWrite(UTF8ToString($0));
+           }, ro_szCheckpoint);
+#endif
+
+    g_free(szTemp);
+    g_free(arca);
+
+    RolloutCheckpointDue();
+}
+
 static rolloutprogressfunc *ro_pfProgress;
 static void *ro_pUserData;
 
@@ -1266,6 +1933,14 @@ UpdateProgress(gpointer UNUSED(unused))
         MT_Release();
         multi_debug("exclusive release: update progress");
     }
+
+    if (ro_szCheckpoint && ro_alternatives > 0 && g_get_monotonic_time() >= ro_tCheckpoint) {
+        multi_debug("exclusive lock: rollout checkpoint");
+        MT_Exclusive();
+        RolloutCheckpoint();
+        MT_Release();
+        multi_debug("exclusive release: rollout checkpoint");
+    }
     return TRUE;
 }
 
@@ -1291,6 +1966,7 @@ RolloutGeneral(ConstTanBoard * apBoard,
     int fOutputMWCSave = fOutputMWC;
     int active_alternatives;
     int previous_rollouts = 0;
+    double tPhase;
 
     show_jsds = 1;
 
@@ -1299,6 +1975,8 @@ RolloutGeneral(ConstTanBoard * apBoard,
         return -1;
     }
 
+    tPhase = EvalStatsPhaseStart(STATS_PHASE_ROLLOUT);
+
     ajiJSD = g_alloca(alternatives * sizeof(jsdinfo));
     fNoMore = g_alloca(alternatives * sizeof(int));
     aciLocal = g_alloca(alternatives * sizeof(cubeinfo));
@@ -1326,11 +2004,6 @@ RolloutGeneral(ConstTanBoard * apBoard,
                 rcRollout.aecCubeLate[i].fCubeful = rcRollout.aecChequerLate[i].fCubeful = 1;
     }
 
-    /* quasi random dice may not be thread safe when we need to skip
-     * some rolls for initial positions */
-    if (rcRollout.fInitial)
-        rcRollout.fRotate = FALSE;
-
     /* nFirstTrial will be the smallest number of trials done for an alternative */
     nFirstTrial = cGames = rcRollout.nTrials;
     initial_game_count = 0;
@@ -1401,6 +2074,12 @@ RolloutGeneral(ConstTanBoard * apBoard,
                 r = aarSigma[alt][j] = (*apStdDev[alt])[j];
                 aarVariance[alt][j] = r * r * nGames;
             }
+
+            /* a checkpoint has the sums themselves */
+            if (ro_arcaResume) {
+                memcpy(aarResult[alt], ro_arcaResume[alt].arResult, sizeof(aarResult[alt]));
+                memcpy(aarVariance[alt], ro_arcaResume[alt].arVariance, sizeof(aarVariance[alt]));
+            }
         }
 
         /* force all moves/cube decisions to be considered and reset the upper bound on trials */
@@ -1441,6 +2120,14 @@ RolloutGeneral(ConstTanBoard * apBoard,
     ro_NextTrial = nFirstTrial;
     ro_pfProgress = pfProgress;
     ro_pUserData = pUserData;
+    ro_prcStart = &rcRolloutSave;
+
+    if (fAutoSaveCheckpoint) {
+        ro_szCheckpoint = ro_szResume ? g_strdup(ro_szResume) : RolloutCheckpointFile();
+        RolloutCheckpointDue();
+    }
+
+    RolloutDicePermsStart();
 
     active_alternatives = ro_alternatives;
 
@@ -1476,11 +2163,22 @@ RolloutGeneral(ConstTanBoard * apBoard,
     if (!fInterrupt)
         UpdateProgress(NULL);
 
+    /* the last checkpoint keeps an interrupted rollout too */
+    if (ro_szCheckpoint) {
+        RolloutCheckpoint();
+        g_free(ro_szCheckpoint);
+        ro_szCheckpoint = NULL;
+    }
+
+    RolloutDicePermsFinish();
+
     /* Signal to UpdateProgress() called from pending events that no
      * more progress should be displayed.
      */
     ro_alternatives = -1;
 
+    EvalStatsPhaseEnd(STATS_PHASE_ROLLOUT, tPhase);
+
     for (alt = 0, trialsDone = 0; alt < alternatives; ++alt) {
         if (apes[alt]->rc.nGamesDone > trialsDone)
             trialsDone = apes[alt]->rc.nGamesDone;
@@ -1686,7 +2384,6 @@ GeneralCubeDecisionR(float aarOutput[2][NUM_ROLLOUT_OUTPUTS],
         return -1;
 
     pes->rc.nGamesDone = cGames;
-    pes->rc.nSkip = nSkip;
 
     return 0;
 
@@ -1871,4 +2568,100 @@ ScoreMoveRollout(move ** ppm, cubeinfo ** ppci, int cMoves, rolloutprogressfunc
     return 0;
 }
 
+/* "rollout resume": goes on with the rollout in a checkpoint file, with
+ * the settings it was started with, and goes on writing checkpoints to
+ * the same file */
+
+extern void
+CommandRolloutResume(char *sz)
+{
+    rolloutcheckpointhead h;
+    rolloutcheckpointalt *arca;
+    rolloutcontext rcSave;
+    ConstTanBoard *apBoard;
+    float (**apOutput)[NUM_ROLLOUT_OUTPUTS];
+    float (**apStdDev)[NUM_ROLLOUT_OUTPUTS];
+    rolloutstat(*aars)[2];
+    evalsetup **apes;
+    const cubeinfo **apci;
+    int **apCubeDecTop;
+    char (*asz)[40];
+    char *pch, *szFile;
+    void *p;
+    FILE *pf;
+    int alt;
+
+    pch = NextToken(&sz);
+    szFile = pch && *pch ? g_strdup(pch) : RolloutCheckpointFile();
+
+    if (!(pf = g_fopen(szFile, "rb"))) {
+        outputerr(szFile);
+        g_free(szFile);
+        return;
+    }
+
+    arca = NULL;
+    if (fread(&h, sizeof(h), 1, pf) != 1 || memcmp(h.szMagic, ROLLOUT_CHECKPOINT_MAGIC, sizeof(h.szMagic))
+        || h.nVersion != ROLLOUT_CHECKPOINT_VERSION || h.nByteOrder != ROLLOUT_CHECKPOINT_BYTEORDER
+        || h.cbAlt != sizeof(rolloutcheckpointalt) || h.alternatives < 1
+        || !(arca = g_try_new(rolloutcheckpointalt, h.alternatives))
+        || fread(arca, sizeof(*arca), h.alternatives, pf) != (size_t) h.alternatives) {
+        outputf(_("%s is not a rollout checkpoint saved by this version of GNU Backgammon.\n"), szFile);
+        fclose(pf);
+        g_free(arca);
+        g_free(szFile);
+        return;
+    }
+
+    fclose(pf);
+
+    apBoard = g_alloca(h.alternatives * sizeof(int *));
+    apOutput = g_alloca(h.alternatives * sizeof(float *));
+    apStdDev = g_alloca(h.alternatives * sizeof(float *));
+    aars = g_alloca(h.alternatives * 2 * sizeof(rolloutstat));
+    apes = g_alloca(h.alternatives * sizeof(evalsetup *));
+    apci = g_alloca(h.alternatives * sizeof(cubeinfo *));
+    apCubeDecTop = g_alloca(h.alternatives * sizeof(int *));
+    asz = g_alloca(h.alternatives * 40);
+
+    for (alt = 0; alt < h.alternatives; alt++) {
+        rolloutcheckpointalt *prca = &arca[alt];
+
+        apBoard[alt] = (ConstTanBoard) prca->anBoard;
+        apOutput[alt] = &prca->arMu;
+        apStdDev[alt] = &prca->arSigma;
+        memcpy(aars[alt], prca->ars, sizeof(aars[alt]));
+        apes[alt] = &prca->es;
+        apci[alt] = &prca->ci;
+        apCubeDecTop[alt] = &prca->fCubeDecTop;
+
+        if (h.alternatives == 1)
+            strcpy(asz[alt], _("Position"));
+        else
+            sprintf(asz[alt], _("Alternative %d"), alt + 1);
+    }
+    if (h.fCubeRollout && h.alternatives == 2)
+        FormatCubePositions(&arca[0].ci, asz);
+
+    outputf(_("Resuming the rollout in %s.\n"), szFile);
+
+    memcpy(&rcSave, &rcRollout, sizeof(rcRollout));
+    memcpy(&rcRollout, &h.rc, sizeof(rcRollout));
+    ro_szResume = szFile;
+    ro_arcaResume = arca;
+
+    RolloutProgressStart(&arca[0].ci, h.alternatives, h.fStatistics ? aars : NULL, &rcRollout, asz,
+                         h.alternatives > 1, &p);
+    RolloutGeneral(apBoard, apOutput, apStdDev, h.fStatistics ? aars : NULL, apes, apci, apCubeDecTop,
+                   h.alternatives, h.fInvert, h.fCubeRollout, RolloutProgress, p);
+    RolloutProgressEnd(&p, FALSE);
+
+    ro_arcaResume = NULL;
+    ro_szResume = NULL;
+    memcpy(&rcRollout, &rcSave, sizeof(rcRollout));
+
+    g_free(arca);
+    g_free(szFile);
+}
+
 #endif
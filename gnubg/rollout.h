@@ -143,6 +143,8 @@ ScoreMoveRollout(move ** ppm, cubeinfo ** ppci, int cMoves,
 
 extern void RolloutLoopMT(void *unused);
 
+extern char *RolloutCheckpointFile(void);
+
 /* Quasi-random permutation array: the first index is the "generation" of the
  * permutation (0 permutes each set of 36 rolls, 1 permutes those sets of 36
  * into 1296, etc.); the second is the roll within the game (limited to 128,
@@ -150,12 +152,14 @@ extern void RolloutLoopMT(void *unused);
  * itself.  6 generations are enough for 36^6 > 2^31 trials. */
 typedef struct _perArray {
     unsigned char aaanPermutation[6][128][36];
+    /* where the rolls other than doubles are in aaanPermutation[0][0] */
+    unsigned char anNonDouble[30];
     int nPermutationSeed;
 } perArray;
 
 EXP_LOCK_FUN(int, BasicCubefulRollout, unsigned int aanBoard[][2][25], float aarOutput[][NUM_ROLLOUT_OUTPUTS],
              int iTurn, int iGame, const cubeinfo aci[], int afCubeDecTop[], unsigned int cci, rolloutcontext * prc,
-             rolloutstat aarsStatistics[][2], int nBasisCube, perArray * dicePerms, rngcontext * rngctxRollout,
+             rolloutstat aarsStatistics[][2], int nBasisCube, const perArray * dicePerms, rngcontext * rngctxRollout,
              FILE * logfp);
 
 
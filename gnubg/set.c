@@ -97,6 +97,7 @@ static const char *szSetCommand;
 static rolloutcontext *prcSet;
 
 static evalsetup *pesSet;
+static unsigned int *pnTimeSet;
 
 static rng *rngSet;
 static rngcontext *rngctxSet;
@@ -671,6 +672,22 @@ CommandSetThreads(char *sz)
     MT_SetNumThreads(n);
     outputf(_("The number of threads has been set to %d.\n"), n);
 }
+
+extern void
+CommandSetRolloutMergeInterval(char *sz)
+{
+    int n;
+
+    if ((n = ParseNumber(&sz)) <= 0) {
+        outputl(_("You must specify a positive number of trials (see `help set rolloutmerge')."));
+
+        return;
+    }
+
+    nRolloutMergeInterval = (unsigned int) n;
+    outputf(ngettext("Calculation threads will merge their rollout results after every trial.\n",
+                     "Calculation threads will merge their rollout results every %d trials.\n", n), n);
+}
 #endif
 
 extern void
@@ -1376,10 +1393,11 @@ CommandSetPlayerChequerplay(char *sz)
     szSet = ap[iPlayerSet].szName;
     szSetCommand = "player chequerplay evaluation";
     pesSet = &ap[iPlayerSet].esChequer;
+    pnTimeSet = &ap[iPlayerSet].nChequerTime;
 
     outputpostpone();
 
-    HandleCommand(sz, acSetEvalParam);
+    HandleCommand(sz, acSetPlayerEvalParam);
 
     if (ap[iPlayerSet].pt != PLAYER_GNU)
         outputf(_("(Note that this setting will have no effect until you "
@@ -1396,10 +1414,11 @@ CommandSetPlayerCubedecision(char *sz)
     szSet = ap[iPlayerSet].szName;
     szSetCommand = "player cubedecision evaluation";
     pesSet = &ap[iPlayerSet].esCube;
+    pnTimeSet = &ap[iPlayerSet].nCubeTime;
 
     outputpostpone();
 
-    HandleCommand(sz, acSetEvalParam);
+    HandleCommand(sz, acSetPlayerEvalParam);
 
     if (ap[iPlayerSet].pt != PLAYER_GNU)
         outputf(_("(Note that this setting will have no effect until you "
@@ -1409,6 +1428,27 @@ CommandSetPlayerCubedecision(char *sz)
 }
 
 
+extern void
+CommandSetPlayerEvalParamTimed(char *sz)
+{
+
+    int n = ParseNumber(&sz);
+
+    if (n < 0) {
+        outputl(_("You must specify how many milliseconds to think "
+                  "(see `help set player chequerplay timed')."));
+        return;
+    }
+
+    *pnTimeSet = n;
+
+    if (n)
+        outputf(_("%s will deepen its evaluation one ply at a time for up to %d milliseconds.\n"), szSet, n);
+    else
+        outputf(_("%s will evaluate without a time limit.\n"), szSet);
+}
+
+
 extern void
 CommandSetPlayerExternal(char *sz)
 {
@@ -3060,6 +3100,53 @@ CommandSetEvalSameAsAnalysis(char *sz)
               _("Evaluation settings separate from analysis settings."));
 }
 
+extern void
+CommandSetEvalProgressive(char *sz)
+{
+    SetToggle("evaluation progressive", &fEvalProgressive, sz,
+              _("Candidate moves will be dropped once their likeliest rolls show they cannot catch the "
+                "leader."),
+              _("Every candidate move will be evaluated on all 21 rolls."));
+}
+
+extern void
+CommandSetEvalQuantized(char *sz)
+{
+    int f = fEvalQuantized;
+
+    if (SetToggle("evaluation quantized", &f, sz,
+                  _("Neural net evaluations will use fixed point weights."),
+                  _("Neural net evaluations will use floating point weights.")) < 0)
+        return;
+
+    /* the fixed point weights are only kept while they are used */
+    if (f && !fEvalQuantized && EvalQuantize(TRUE)) {
+        outputl(_("The fixed point weights are not available."));
+        return;
+    }
+
+    if (f != fEvalQuantized) {
+        fEvalQuantized = f;
+        if (!f)
+            EvalQuantize(FALSE);
+        /* cached evaluations came from the other set of weights */
+        EvalCacheFlush();
+    }
+}
+
+extern void
+CommandSetEvalBitboardMoves(char *sz)
+{
+    int f = fMoveGenBits;
+
+    if (SetToggle("evaluation bitboardmoves", &f, sz,
+                  _("Moves will be generated from bit masks of the points."),
+                  _("Moves will be generated from the board array.")) < 0)
+        return;
+
+    fMoveGenBits = f;
+}
+
 extern void
 CommandSetAnalysisPlayer(char *sz)
 {
@@ -4687,6 +4774,26 @@ CommandSetAutoSaveAnalysis(char *sz)
               _("Auto save after each analysed game"), _("Don't auto save after each analysed game"));
 }
 
+extern void
+CommandSetAutoSaveCheckpoint(char *sz)
+{
+    SetToggle("autosave checkpoint", &fAutoSaveCheckpoint, sz,
+              _("Write checkpoints during rollouts"), _("Don't write checkpoints during rollouts"));
+}
+
+extern void
+CommandSetAutoSaveCheckpointFile(char *sz)
+{
+    char *pch = NextToken(&sz);
+
+    g_free(szRolloutCheckpoint);
+    szRolloutCheckpoint = pch && *pch ? g_strdup(pch) : NULL;
+
+    pch = RolloutCheckpointFile();
+    outputf(_("Rollout checkpoints will be written to %s.\n"), pch);
+    g_free(pch);
+}
+
 extern void
 CommandSetAutoSaveConfirmDelete(char *sz)
 {
@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -548,6 +549,180 @@ CommandShowCache(char *UNUSED(sz))
     outputc('\n');
 }
 
+static const char *aszStatsClass[STATS_CLASSES] = {
+    N_("Over"),
+    N_("Hypergammon-1"),
+    N_("Hypergammon-2"),
+    N_("Hypergammon-3"),
+    N_("Bearoff2"),
+    N_("Bearoff-TS"),
+    N_("Bearoff1"),
+    N_("Bearoff-OS"),
+    N_("Race"),
+    N_("Crashed"),
+    N_("Contact"),
+    N_("Cubeful, any")
+};
+
+static const char *aszStatsNet[STATS_NETS] = {
+    N_("Contact"),
+    N_("Crashed"),
+    N_("Race"),
+    N_("Pruning contact"),
+    N_("Pruning crashed"),
+    N_("Pruning race")
+};
+
+static const char *aszStatsPhase[STATS_PHASES] = {
+    N_("Chequer play"),
+    N_("Cube decisions"),
+    N_("Rollouts")
+};
+
+static const char *aszStatsNetKey[STATS_NETS] = {
+    "contact", "crashed", "race", "pruningContact", "pruningCrashed", "pruningRace"
+};
+
+static const char *aszStatsPhaseKey[STATS_PHASES] = { "chequer", "cube", "rollout" };
+
+static float
+StatsRate(uint64_t c, uint64_t n)
+{
+    return n ? (float) c * 100.0f / (float) n : 0.0f;
+}
+
+static void
+ShowStatisticsEngineJSON(const evalstats * pes)
+{
+    int i, j;
+
+    outputf("{\"classes\": [");
+    for (j = 0; j < STATS_CLASSES; j++)
+        outputf("%s\"%s\"", j ? ", " : "", aszStatsClass[j]);
+
+    outputf("],\n \"cache\": {\"entries\": %u, \"used\": %u,\n  \"lookups\": [",
+            cEval.size, CacheUsed(&cEval));
+    for (i = 0; i < STATS_PLIES; i++) {
+        outputf("%s[", i ? ", " : "");
+        for (j = 0; j < STATS_CLASSES; j++)
+            outputf("%s%" PRIu64, j ? ", " : "", pes->aacCacheLookup[i][j]);
+        outputc(']');
+    }
+    outputf("],\n  \"hits\": [");
+    for (i = 0; i < STATS_PLIES; i++) {
+        outputf("%s[", i ? ", " : "");
+        for (j = 0; j < STATS_CLASSES; j++)
+            outputf("%s%" PRIu64, j ? ", " : "", pes->aacCacheHit[i][j]);
+        outputc(']');
+    }
+    outputf("],\n  \"evictions\": [");
+    for (i = 0; i < STATS_PLIES; i++)
+        outputf("%s%" PRIu64, i ? ", " : "", pes->acCacheEvict[i]);
+    outputf("],\n  \"pruning\": {\"lookups\": %" PRIu64 ", \"hits\": %" PRIu64 "}},\n",
+            pes->cPruneLookup, pes->cPruneHit);
+
+    outputf(" \"nets\": {");
+    for (i = 0; i < STATS_NETS; i++)
+        outputf("%s\"%s\": %" PRIu64, i ? ", " : "", aszStatsNetKey[i], pes->acNetEval[i]);
+
+    outputf("},\n \"movegen\": {\"calls\": %" PRIu64 ", \"moves\": %" PRIu64 "},\n",
+            pes->cMoveGen, pes->cMovesGenerated);
+
+    outputf(" \"search\": {\"moves\": [");
+    for (i = 0; i < STATS_PLIES; i++)
+        outputf("%s%" PRIu64, i ? ", " : "", pes->acSearchMoves[i]);
+    outputf("], \"ms\": [");
+    for (i = 0; i < STATS_PLIES; i++)
+        outputf("%s%.1f", i ? ", " : "", pes->arSearchTime[i]);
+
+    outputf("]},\n \"progressive\": {\"moves\": [");
+    for (i = 0; i < STATS_PLIES; i++)
+        outputf("%s%" PRIu64, i ? ", " : "", pes->acProgressiveMoves[i]);
+    outputf("], \"dropped\": [");
+    for (i = 0; i < STATS_PLIES; i++)
+        outputf("%s%" PRIu64, i ? ", " : "", pes->acProgressiveDropped[i]);
+    outputf("], \"skipped\": [");
+    for (i = 0; i < STATS_PLIES; i++)
+        outputf("%s%" PRIu64, i ? ", " : "", pes->acProgressiveSkipped[i]);
+
+    outputf("]},\n \"phases\": {");
+    for (i = 0; i < STATS_PHASES; i++)
+        outputf("%s\"%s\": {\"calls\": %" PRIu64 ", \"ms\": %.1f}",
+                i ? ", " : "", aszStatsPhaseKey[i], pes->acPhase[i], pes->arPhaseTime[i]);
+    outputl("}}");
+}
+
+extern void
+CommandShowStatisticsEngine(char *sz)
+{
+    evalstats es;
+    uint64_t c;
+    int i, j;
+
+    EvalStatsSum(&es);
+
+    sz = NextToken(&sz);
+    if (sz && !StrNCaseCmp(sz, "json", strlen(sz))) {
+        ShowStatisticsEngineJSON(&es);
+        return;
+    }
+
+    outputf(_("Evaluation cache: %u entries, %u used\n"), cEval.size, CacheUsed(&cEval));
+    outputf("  %-6s %-14s %14s %14s %9s\n", _("Depth"), _("Class"), _("Lookups"), _("Hits"), _("Hit rate"));
+    for (i = 0; i < STATS_PLIES; i++)
+        for (j = 0; j < STATS_CLASSES; j++)
+            if (es.aacCacheLookup[i][j])
+                outputf("  %d%-5s %-14s %14" PRIu64 " %14" PRIu64 " %8.1f%%\n",
+                        i, i == STATS_PLIES - 1 ? _("+-ply") : _("-ply"), gettext(aszStatsClass[j]),
+                        es.aacCacheLookup[i][j], es.aacCacheHit[i][j],
+                        StatsRate(es.aacCacheHit[i][j], es.aacCacheLookup[i][j]));
+
+    outputf("  %s", _("Entries dropped, by their depth:"));
+    for (i = 0, c = 0; i < STATS_PLIES; i++)
+        if (es.acCacheEvict[i]) {
+            outputf(" %d%s %" PRIu64, i, i == STATS_PLIES - 1 ? _("+-ply") : _("-ply"),
+                    es.acCacheEvict[i]);
+            c += es.acCacheEvict[i];
+        }
+    outputl(c ? "" : _(" none"));
+
+    outputf(_("Pruning cache: %" PRIu64 " lookups, %" PRIu64 " hits (%.1f%%)\n\n"),
+            es.cPruneLookup, es.cPruneHit, StatsRate(es.cPruneHit, es.cPruneLookup));
+
+    outputl(_("Neural net evaluations:"));
+    for (i = 0; i < STATS_NETS; i++)
+        outputf("  %-16s %14" PRIu64 "\n", gettext(aszStatsNet[i]), es.acNetEval[i]);
+
+    outputf(_("\nMove generation: %" PRIu64 " calls, %" PRIu64 " moves\n\n"),
+            es.cMoveGen, es.cMovesGenerated);
+
+    outputl(_("Chequer play search, outermost calls only:"));
+    outputf("  %-6s %14s %12s\n", _("Depth"), _("Moves scored"), _("Seconds"));
+    for (i = 0; i < STATS_PLIES; i++)
+        if (es.acSearchMoves[i])
+            outputf("  %d%-5s %14" PRIu64 " %12.3f\n",
+                    i, i == STATS_PLIES - 1 ? _("+-ply") : _("-ply"), es.acSearchMoves[i],
+                    es.arSearchTime[i] / 1000.0);
+
+    for (i = 0, c = 0; i < STATS_PLIES; i++)
+        c += es.acProgressiveMoves[i];
+    if (c) {
+        outputl(_("\nProgressive move scoring:"));
+        outputf("  %-6s %14s %14s %14s\n", _("Depth"), _("Moves"), _("Dropped"), _("Rolls skipped"));
+        for (i = 0; i < STATS_PLIES; i++)
+            if (es.acProgressiveMoves[i])
+                outputf("  %d%-5s %14" PRIu64 " %14" PRIu64 " %14" PRIu64 "\n",
+                        i, i == STATS_PLIES - 1 ? _("+-ply") : _("-ply"), es.acProgressiveMoves[i],
+                        es.acProgressiveDropped[i], es.acProgressiveSkipped[i]);
+    }
+
+    outputl(_("\nPhases, outermost calls only:"));
+    outputf("  %-16s %14s %12s\n", "", _("Calls"), _("Seconds"));
+    for (i = 0; i < STATS_PHASES; i++)
+        outputf("  %-16s %14" PRIu64 " %12.3f\n", gettext(aszStatsPhase[i]), es.acPhase[i],
+                es.arPhaseTime[i] / 1000.0);
+}
+
 extern void
 CommandShowCalibration(char *UNUSED(sz))
 {
@@ -715,9 +890,44 @@ CommandShowEngine(char *UNUSED(sz))
     output(szBuffer);
 }
 
+/* The checks of the faster evaluation paths against the ones they
+ * stand in for.  They take a few seconds, so they only run when asked
+ * for. */
+
+static void
+ShowEvaluationSelfCheck(void)
+{
+    unsigned int cPositions, cMismatches;
+    float rDeviation, rMaxTable, rMaxExact;
+    double rInputs, rNet;
+
+    NeuralNetSigmoidError(&rMaxTable, &rMaxExact);
+    outputf(_("Hidden layer sigmoid: maximum error %.2g against the lookup table (bound 1.2e-7), "
+              "%.2g against 1/(1+expf(x)) (bound 1.2e-3), over [-10.5, 10.5]\n"), rMaxTable, rMaxExact);
+
+    cMismatches = EscapeMaskMismatches(1000000, &rInputs, &rNet);
+    outputf(_("Escape counts from made point masks: %u of 1000000 positions differ from the board walk "
+              "(both sides, n = -1 to 24); contact inputs %.2f us, contact net %.2f us per position\n"),
+            cMismatches, rInputs * 1e3, rNet * 1e3);
+
+    outputf(_("Move generation from bit masks: %u of 42000 movelists differ from the board array generator "
+              "(1000 reference positions, 21 rolls, complete and partial moves)\n"), MoveGenMismatches(1000));
+
+    if ((rDeviation = QuantizedEvalDeviation(&cPositions)) < 0.0f)
+        outputl(_("Quantized evaluation: the fixed point weights are not available."));
+    else
+        outputf(_("Quantized evaluation: maximum equity deviation from floating point evaluation %.5f "
+                  "(%u reference positions)\n"), rDeviation, cPositions);
+}
+
 extern void
-CommandShowEvaluation(char *UNUSED(sz))
+CommandShowEvaluation(char *sz)
 {
+    sz = NextToken(&sz);
+    if (sz && !StrNCaseCmp(sz, "selfcheck", strlen(sz))) {
+        ShowEvaluationSelfCheck();
+        return;
+    }
 
     outputl(_("`eval' and `hint' will use:"));
     outputl(_("    Chequer play:"));
@@ -842,10 +1052,14 @@ CommandShowPlayer(char *UNUSED(sz))
             outputf(_("gnubg:\n"));
             outputl(_("    Checker play:"));
             ShowEvalSetup(&ap[i].esChequer);
+            if (ap[i].nChequerTime)
+                outputf(_("        Deepened one ply at a time for up to %u milliseconds.\n"), ap[i].nChequerTime);
             outputl(_("    Move filters:"));
             ShowMoveFilters(ap[i].aamf);
             outputl(_("    Cube decisions:"));
             ShowEvalSetup(&ap[i].esCube);
+            if (ap[i].nCubeTime && ap[i].esCube.et == EVAL_EVAL)
+                outputf(_("        Deepened one ply at a time for up to %u milliseconds.\n"), ap[i].nCubeTime);
             break;
         case PLAYER_HUMAN:
             outputl(_("human\n"));
@@ -1143,6 +1357,14 @@ CommandShowThreads(char *UNUSED(sz))
     int c = MT_GetNumThreads();
     outputf(ngettext("%d calculation thread.\n", "%d calculation threads.\n", c), c);
 }
+
+extern void
+CommandShowRolloutMergeInterval(char *UNUSED(sz))
+{
+    outputf(ngettext("Calculation threads merge their rollout results after every trial.\n",
+                     "Calculation threads merge their rollout results every %u trials.\n",
+                     nRolloutMergeInterval), nRolloutMergeInterval);
+}
 #endif
 
 extern void
@@ -2253,4 +2475,11 @@ CommandShowAutoSave(char *UNUSED(sz))
             _("Match will not be autosaved during and after rollouts\n"));
     outputf(fAutoSaveAnalysis ? _("Match will be autosaved during and after analysis\n") :
             _("Match will not be autosaved during and after analysis\n"));
+    if (fAutoSaveCheckpoint) {
+        char *sz = RolloutCheckpointFile();
+
+        outputf(_("Rollouts will write checkpoints to %s\n"), sz);
+        g_free(sz);
+    } else
+        outputf(_("Rollouts will not write checkpoints\n"));
 }
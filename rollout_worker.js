@@ -0,0 +1,83 @@
+// A rollout worker: loads its own engine and plays the units of the
+// rollouts the page hands to its RolloutPool (see rolloutpool.js).
+
+importScripts("rolloutpool.js");
+
+var lastSettings = "";
+var commandBuffer = 0;
+
+function runCommand(command) {
+    if (!commandBuffer)
+        commandBuffer = Module._malloc(1000);
+    for (var i = 0; i < command.length; i++)
+        Module.setValue(commandBuffer + i, command.charCodeAt(i), "i8");
+    Module.setValue(commandBuffer + command.length, 0, "i8");
+    Module._run_command(commandBuffer);
+}
+
+function playJob(data) {
+    var layout = new RolloutPoolLayout(data.sab, data.alternatives, data.outputs, data.statWords);
+    var i32 = layout.i32;
+    var pJob = Module._malloc(data.job.length);
+    var pOut = Module._malloc(4 * data.outputs);
+    var pStats = Module._malloc(4 * Math.max(data.statWords, 1));
+
+    // the engine settings only change between rollouts now and then
+    if (data.settings != lastSettings) {
+        data.settings.split("\n").forEach(function(command) {
+            if (command)
+                runCommand(command);
+        });
+        lastSettings = data.settings;
+    }
+
+    Module.HEAPU8.set(data.job, pJob);
+    Module._rollout_pool_job(pJob);
+
+    for (;;) {
+        var u = Atomics.add(i32, POOL_NEXT, 1);
+        var p, fPlayed;
+
+        if (u >= data.units || Atomics.load(i32, POOL_CANCEL))
+            break;
+
+        // wait for the page to take up the units ahead of this one
+        for (;;) {
+            var low = Atomics.load(i32, POOL_LOW);
+
+            if (u < low + layout.slots || Atomics.load(i32, POOL_CANCEL))
+                break;
+            Atomics.wait(i32, POOL_LOW, low, 100);
+        }
+        if (Atomics.load(i32, POOL_CANCEL))
+            break;
+
+        p = layout.slot(u);
+        layout.claimSlot(p, u);
+
+        // alternatives the page has stopped are skipped
+        fPlayed = !Atomics.load(i32, POOL_HEADER + u % data.alternatives) &&
+            Module._rollout_pool_play(u, pOut, pStats);
+        layout.fillSlot(p, Module.HEAPU8.buffer, pOut, pStats, fPlayed);
+    }
+
+    Module._free(pStats);
+    Module._free(pOut);
+    Module._free(pJob);
+}
+
+var Module = {
+    print: function() {},
+    printErr: function(str) {
+        console.log(str);
+    },
+    onRuntimeInitialized: function() {
+        Module._start();
+        onmessage = function(event) {
+            playJob(event.data);
+        };
+        postMessage("ready");
+    }
+};
+
+importScripts("gnubg.js");
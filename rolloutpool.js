@@ -0,0 +1,187 @@
+// A pool of Web Workers for rollouts.  Each worker (rollout_worker.js)
+// runs its own copy of the engine; RolloutLoopMT() in rollout.c hands a
+// rollout to the pool and takes the results of the trials back in order.
+//
+// The pool and the workers share one SharedArrayBuffer per rollout, as
+// 32 bit words:
+//
+//   [POOL_NEXT]    the next unit nobody has claimed yet
+//   [POOL_LOW]     the first unit the engine still needs; units at or
+//                  beyond POOL_LOW + slots wait until it moves on
+//   [POOL_CANCEL]  set when the rollout is over
+//   then one stop flag per alternative, then the slots.  Unit u lives
+//   in slot u % slots: its unit number, its state, the outputs of the
+//   trial and, for cube rollouts, the statistics.
+//
+// SharedArrayBuffer needs a cross-origin isolated page; without one
+// there is no pool and rollouts run on the page as before.
+//
+// The page makes the pool on its first rollout rather than at load, so
+// that a visit without rollouts starts no workers.  Each worker is a
+// whole engine with its own caches, hence the cap.  The page is busy
+// for the whole of a rollout and only hears from the workers after it,
+// so the first rollout is played on the page alone.
+
+POOL_MAX_WORKERS = 4;
+
+POOL_NEXT = 0;
+POOL_LOW = 1;
+POOL_CANCEL = 2;
+POOL_HEADER = 4;
+// rounds of all alternatives that may be played ahead of the engine
+POOL_ROUNDS = 64;
+
+SLOT_CLAIMED = 1;
+SLOT_DONE = 2;
+SLOT_SKIPPED = 3;
+
+function RolloutPoolLayout(sab, alternatives, outputs, statWords) {
+    this.i32 = new Int32Array(sab);
+    this.f32 = new Float32Array(sab);
+    this.alternatives = alternatives;
+    this.outputs = outputs;
+    this.statWords = statWords;
+    this.slots = alternatives * POOL_ROUNDS;
+    this.slotWords = 2 + outputs + statWords;
+}
+
+RolloutPoolLayout.bytes = function(alternatives, outputs, statWords) {
+    return 4 * (POOL_HEADER + alternatives + alternatives * POOL_ROUNDS * (2 + outputs + statWords));
+};
+
+RolloutPoolLayout.prototype.slot = function(u) {
+    return POOL_HEADER + this.alternatives + (u % this.slots) * this.slotWords;
+};
+
+// Claims slot p for unit u.  The state goes first, so that a slot never
+// shows the new unit with the results of the old one.
+RolloutPoolLayout.prototype.claimSlot = function(p, u) {
+    Atomics.store(this.i32, p + 1, SLOT_CLAIMED);
+    Atomics.store(this.i32, p, u);
+};
+
+// Fills slot p from the trial results at pOut and pStats in heap (the
+// engine's memory) and publishes them.
+RolloutPoolLayout.prototype.fillSlot = function(p, heap, pOut, pStats, fPlayed) {
+    if (fPlayed) {
+        this.f32.set(new Float32Array(heap, pOut, this.outputs), p + 2);
+        if (this.statWords)
+            this.i32.set(new Int32Array(heap, pStats, this.statWords), p + 2 + this.outputs);
+    }
+    Atomics.store(this.i32, p + 1, fPlayed ? SLOT_DONE : SLOT_SKIPPED);
+};
+
+function RolloutPool(nWorkers) {
+    var pool = this;
+
+    this.workers = [];
+    this.ready = [];
+    this.layout = null;
+
+    for (var i = 0; i < nWorkers; i++) {
+        var worker = new Worker("rollout_worker.js");
+
+        worker.onmessage = function(event) {
+            if (event.data == "ready")
+                pool.ready.push(event.target);
+        };
+        this.workers.push(worker);
+    }
+}
+
+RolloutPool.prototype.size = function() {
+    return this.ready.length;
+};
+
+var rolloutPool = null;
+
+// The number of workers ready to take a rollout, making the pool first
+// if the page can have one.
+function RolloutPoolSize() {
+    if (!rolloutPool) {
+        if (typeof window === "undefined" || !window.crossOriginIsolated || navigator.hardwareConcurrency < 2)
+            return 0;
+        rolloutPool = new RolloutPool(Math.min(navigator.hardwareConcurrency - 1, POOL_MAX_WORKERS));
+    }
+    return rolloutPool.size();
+}
+
+// Hands a rollout to the workers: job is the rollout as laid out by
+// RolloutPoolStart(), settings the engine settings it depends on.
+RolloutPool.prototype.start = function(job, settings, units, alternatives, outputs, statWords) {
+    var sab = new SharedArrayBuffer(RolloutPoolLayout.bytes(alternatives, outputs, statWords));
+    var layout = new RolloutPoolLayout(sab, alternatives, outputs, statWords);
+
+    for (var s = 0; s < layout.slots; s++)
+        layout.i32[POOL_HEADER + alternatives + s * layout.slotWords] = -1;
+
+    this.layout = layout;
+    this.units = units;
+
+    for (var i = 0; i < this.ready.length; i++)
+        this.ready[i].postMessage({
+            job: job, settings: settings, sab: sab, units: units,
+            alternatives: alternatives, outputs: outputs, statWords: statWords
+        });
+};
+
+// Copies the results of unit u to pOut and pStats in heap.  Returns 1
+// if it was played, -1 if a worker skipped it and 0 if it is not back
+// yet.
+RolloutPool.prototype.take = function(u, heap, pOut, pStats) {
+    var layout = this.layout;
+    var p = layout.slot(u);
+    var state;
+
+    if (Atomics.load(layout.i32, p) != u)
+        return 0;
+
+    state = Atomics.load(layout.i32, p + 1);
+    if (state == SLOT_SKIPPED)
+        return -1;
+    if (state != SLOT_DONE)
+        return 0;
+
+    new Float32Array(heap, pOut, layout.outputs).set(layout.f32.subarray(p + 2, p + 2 + layout.outputs));
+    if (layout.statWords)
+        new Int32Array(heap, pStats, layout.statWords).set(
+            layout.i32.subarray(p + 2 + layout.outputs, p + 2 + layout.outputs + layout.statWords));
+    return 1;
+};
+
+// Claims the next unit for the engine itself, as long as it is not
+// beyond unit u.  Returns the unit, or -1.
+RolloutPool.prototype.claim = function(u) {
+    var layout = this.layout;
+
+    for (;;) {
+        var next = Atomics.load(layout.i32, POOL_NEXT);
+
+        if (next > u || next >= this.units)
+            return -1;
+        if (Atomics.compareExchange(layout.i32, POOL_NEXT, next, next + 1) == next) {
+            layout.claimSlot(layout.slot(next), next);
+            return next;
+        }
+    }
+};
+
+// Publishes the results of a unit the engine claimed.
+RolloutPool.prototype.put = function(u, heap, pOut, pStats, fPlayed) {
+    this.layout.fillSlot(this.layout.slot(u), heap, pOut, pStats, fPlayed);
+};
+
+RolloutPool.prototype.advance = function(low) {
+    Atomics.store(this.layout.i32, POOL_LOW, low);
+    Atomics.notify(this.layout.i32, POOL_LOW);
+};
+
+RolloutPool.prototype.stopped = function(alt, fStopped) {
+    Atomics.store(this.layout.i32, POOL_HEADER + alt, fStopped);
+};
+
+RolloutPool.prototype.finish = function() {
+    Atomics.store(this.layout.i32, POOL_CANCEL, 1);
+    Atomics.notify(this.layout.i32, POOL_LOW);
+    this.layout = null;
+};